@@ -530,10 +530,10 @@ arena_reset (Arena *A)
 ARENADEF void
 arena_free (Arena *A)
 {
-  Region *tmp;
-  for_regions2 (A)
+  Region *tmp, *next;
+  for (tmp = A->head; NULL != tmp; tmp = next)
     {
-      tmp = r;
+      next = tmp->next;
       __region_free (tmp);
     }
   A->head = NULL;
@@ -23,6 +23,52 @@
        remove LINK_IMPLEMENTATION macro to get only headers.
        using implementation macro in some files and
        LINK_ONLY_MACRO in others, will cause compile error.
+  
+     unrolled list:
+       define LINK_UNROLLED to get `struct ulist`, a list of
+       chunks (nodes), each holding up to K elements of the
+       same type by value, chunks are linked with list_head
+       traversal touches one node per K elements instead of
+       chasing a pointer per element
+       only the nodes are intrusive (list_head + container_of),
+       elements are copied into the cells of the nodes, so they
+       don't need a list_head, and pointers to them are only
+       valid until they get popped
+       ```c
+          struct ulist ul;
+          INIT_ULIST (ul, int);
+          *(int *)ulist_push_back (&ul) = 1;
+          *(int *)ulist_push_front (&ul) = 0;
+
+          int *p;
+          ulist_for_each (p, &ul)
+            printf ("%d\n", *p);
+          ulist_destroy (&ul);
+       ```
+       it needs LINK_IMPLEMENTATION, and allocates its nodes
+       with `ulist_alloc` and `ulist_free` (malloc by default)
+       ULIST_BYTES is the size of items of each node (512)
+  
+     lock-free queue:
+       define LINK_MPSC to get `struct mpsc_queue`, an intrusive
+       multi-producer single-consumer queue of list_head entries
+       (only ->next is used), any thread can `mpsc_push`, only
+       one thread may `mpsc_pop`; entries are owned by the queue
+       between push and pop, so the consumer may free or reuse
+       popped entries right away (no hazard pointers needed)
+       ```c
+          struct mpsc_queue q;
+          INIT_MPSC_QUEUE (q);
+          mpsc_push (&q, &(task->lnk));  // producers
+          struct list_head *p = mpsc_pop (&q); // consumer
+          if (p) run (container_of (p, struct task, lnk));
+       ```
+       the test program needs -pthread
+  
+     benchmark:
+       traversal of list_head vs unrolled list:
+          cc -O2 -o bench -D LINK_BENCH -D LINK_UNROLLED
+                -D LINK_IMPLEMENTATION linked_list.c
  **/
 #ifndef LINK__H__
 #define LINK__H__
@@ -158,6 +204,127 @@ LINKDEF void link_add_before(struct list_head *pos, struct list_head *new);
  */
 LINKDEF int link_del(struct list_head *head, struct list_head *entry);
 # endif
+
+
+# ifdef LINK_UNROLLED
+#include <stddef.h>
+#ifndef ulist_alloc
+# include <stdlib.h>
+# define ulist_alloc(size) malloc (size)
+# define ulist_free(ptr) free (ptr)
+#endif
+
+#ifndef ULIST_BYTES
+# define ULIST_BYTES 512
+#endif
+
+struct ulist_node {
+  struct list_head lnk;
+  size_t first, len; /* live cells: [first, first + len) */
+  _Alignas (max_align_t) char items[]; /* k cells */
+};
+
+struct ulist {
+  struct list_head head; /* list of ulist_node */
+  size_t cell, k; /* size of cells, cells per node */
+  size_t len; /* number of elements */
+};
+
+/**
+ *  initialize ulist @ul for elements of type @T
+ */
+#define INIT_ULIST(ul, T) do {                                  \
+    INIT_LIST_HEAD ((ul).head);                                 \
+    (ul).cell = sizeof (T);                                     \
+    (ul).k = (ULIST_BYTES > sizeof (T)) ?                       \
+      ULIST_BYTES / sizeof (T) : 1;                             \
+    (ul).len = 0; } while (0)
+
+#define ulist_node_of(ptr) container_of (ptr, struct ulist_node, lnk)
+
+/**
+ *  internal, the cell @i of node @n, moves to the next node
+ *  at the end of @n, @return NULL at the end of @ul
+ */
+static inline void *
+__ulist_cell(struct ulist *ul, struct ulist_node **n, size_t *i)
+{
+  if (&(*n)->lnk == &ul->head)
+    return NULL;
+  if (*i >= (*n)->len)
+    {
+      *n = ulist_node_of ((*n)->lnk.next);
+      *i = 0;
+      if (&(*n)->lnk == &ul->head)
+        return NULL;
+    }
+  return (*n)->items + ((*n)->first + *i) * ul->cell;
+}
+
+/**
+ *  iterate over elements of ulist @ul
+ *  @pos -- pointer to the type of elements, loop cursor
+ *  like list_for_each, it's a single loop, so `break` leaves
+ *  the loop, and @pos remains on the current element
+ */
+#define ulist_for_each(pos, ul)                                         \
+  for (struct {struct ulist_node *n; size_t i;} __uc =                  \
+         {ulist_node_of ((ul)->head.next), 0};                          \
+       (pos = __ulist_cell ((ul), &__uc.n, &__uc.i));                  \
+       ++__uc.i)
+
+/**
+ *  add an element to the end / beginning of @ul
+ *  @return: pointer to the new cell, NULL if allocation failed
+ */
+LINKDEF void *ulist_push_back(struct ulist *ul);
+LINKDEF void *ulist_push_front(struct ulist *ul);
+/**
+ *  get the first / last element of @ul
+ *  @return: NULL if @ul is empty
+ */
+LINKDEF void *ulist_front(struct ulist *ul);
+LINKDEF void *ulist_back(struct ulist *ul);
+/**
+ *  delete the first / last element of @ul
+ *  @return: -1 if @ul is empty
+ */
+LINKDEF int ulist_pop_front(struct ulist *ul);
+LINKDEF int ulist_pop_back(struct ulist *ul);
+/* free all the nodes of @ul */
+LINKDEF void ulist_destroy(struct ulist *ul);
+# endif /* LINK_UNROLLED */
+
+
+# ifdef LINK_MPSC
+#include <stddef.h>
+#include <stdalign.h>
+#include <stdbool.h>
+
+struct mpsc_queue {
+  alignas (64) struct list_head *head; /* producers, the last entry */
+  alignas (64) struct list_head *tail; /* consumer, the first entry */
+  struct list_head stub;
+};
+
+#define INIT_MPSC_QUEUE(q) do {                 \
+    (q).stub.next = NULL;                       \
+    (q).head = (q).tail = &(q).stub; } while (0)
+
+/**
+ *  add @entry to the end of @q (wait-free)
+ *  it's safe to call from multiple threads
+ */
+LINKDEF void mpsc_push(struct mpsc_queue *q, struct list_head *entry);
+/**
+ *  remove the first entry of @q, only from a single thread
+ *  @return: NULL when @q is empty, or when the next entry
+ *  is being pushed at the moment (try again later)
+ */
+LINKDEF struct list_head *mpsc_pop(struct mpsc_queue *q);
+/* whether @q is empty, only from the consumer thread */
+LINKDEF bool mpsc_empty(struct mpsc_queue *q);
+# endif /* LINK_MPSC */
 #endif
 
 
@@ -215,6 +382,170 @@ link_del(struct list_head *head,
   
   return 0;
 }
+
+
+# ifdef LINK_UNROLLED
+static inline struct ulist_node *
+__ulist_new_node(struct ulist *ul, size_t first)
+{
+  struct ulist_node *n;
+  n = ulist_alloc (sizeof (struct ulist_node) + ul->k * ul->cell);
+  if (n)
+    {
+      n->first = first;
+      n->len = 0;
+    }
+  return n;
+}
+
+LINKDEF void *
+ulist_push_back(struct ulist *ul)
+{
+  struct ulist_node *n = ulist_node_of (ul->head.prev);
+
+  if (ul->head.prev == &ul->head || n->first + n->len == ul->k)
+    {
+      if (!(n = __ulist_new_node (ul, 0)))
+        return NULL;
+      link_add_end (&ul->head, &n->lnk);
+    }
+  ul->len++;
+  return n->items + (n->first + n->len++) * ul->cell;
+}
+
+LINKDEF void *
+ulist_push_front(struct ulist *ul)
+{
+  struct ulist_node *n = ulist_node_of (ul->head.next);
+
+  if (ul->head.next == &ul->head || 0 == n->first)
+    {
+      if (!(n = __ulist_new_node (ul, ul->k)))
+        return NULL;
+      link_add_head (&ul->head, &n->lnk);
+    }
+  ul->len++;
+  n->len++;
+  return n->items + (--n->first) * ul->cell;
+}
+
+LINKDEF void *
+ulist_front(struct ulist *ul)
+{
+  struct ulist_node *n = ulist_node_of (ul->head.next);
+  if (0 == ul->len)
+    return NULL;
+  return n->items + n->first * ul->cell;
+}
+
+LINKDEF void *
+ulist_back(struct ulist *ul)
+{
+  struct ulist_node *n = ulist_node_of (ul->head.prev);
+  if (0 == ul->len)
+    return NULL;
+  return n->items + (n->first + n->len - 1) * ul->cell;
+}
+
+LINKDEF int
+ulist_pop_front(struct ulist *ul)
+{
+  struct ulist_node *n = ulist_node_of (ul->head.next);
+
+  if (0 == ul->len)
+    return -1;
+  ul->len--;
+  n->first++;
+  if (0 == --n->len)
+    {
+      link_del (&ul->head, &n->lnk);
+      ulist_free (n);
+    }
+  return 0;
+}
+
+LINKDEF int
+ulist_pop_back(struct ulist *ul)
+{
+  struct ulist_node *n = ulist_node_of (ul->head.prev);
+
+  if (0 == ul->len)
+    return -1;
+  ul->len--;
+  if (0 == --n->len)
+    {
+      link_del (&ul->head, &n->lnk);
+      ulist_free (n);
+    }
+  return 0;
+}
+
+LINKDEF void
+ulist_destroy(struct ulist *ul)
+{
+  struct list_head *p = ul->head.next, *next;
+  for (; p != &ul->head; p = next)
+    {
+      next = p->next;
+      ulist_free (ulist_node_of (p));
+    }
+  ul->head.next = ul->head.prev = &ul->head;
+  ul->len = 0;
+}
+# endif /* LINK_UNROLLED */
+
+
+# ifdef LINK_MPSC
+LINKDEF void
+mpsc_push(struct mpsc_queue *q, struct list_head *entry)
+{
+  struct list_head *prev;
+
+  __atomic_store_n (&entry->next, NULL, __ATOMIC_RELAXED);
+  prev = __atomic_exchange_n (&q->head, entry, __ATOMIC_ACQ_REL);
+  /* the consumer can't pass @prev until this store */
+  __atomic_store_n (&prev->next, entry, __ATOMIC_RELEASE);
+}
+
+LINKDEF struct list_head *
+mpsc_pop(struct mpsc_queue *q)
+{
+  struct list_head *tail = q->tail;
+  struct list_head *next = __atomic_load_n (&tail->next, __ATOMIC_ACQUIRE);
+
+  if (tail == &q->stub)
+    {
+      if (NULL == next)
+        return NULL;
+      q->tail = tail = next;
+      next = __atomic_load_n (&tail->next, __ATOMIC_ACQUIRE);
+    }
+  if (next)
+    {
+      q->tail = next;
+      return tail;
+    }
+
+  /* @tail is the last entry, or a push is in progress */
+  if (tail != __atomic_load_n (&q->head, __ATOMIC_ACQUIRE))
+    return NULL;
+  mpsc_push (q, &q->stub);
+  next = __atomic_load_n (&tail->next, __ATOMIC_ACQUIRE);
+  if (next)
+    {
+      q->tail = next;
+      return tail;
+    }
+  return NULL;
+}
+
+LINKDEF bool
+mpsc_empty(struct mpsc_queue *q)
+{
+  return q->tail == &q->stub
+    && NULL == __atomic_load_n (&q->stub.next, __ATOMIC_ACQUIRE);
+}
+# endif /* LINK_MPSC */
 #endif
 
 
@@ -238,6 +569,33 @@ print_data(struct data *d)
 }
 
 
+#ifdef LINK_MPSC
+#include <pthread.h>
+#include <sched.h>
+#define MPSC_PRODUCERS 4
+#define MPSC_ITEMS 20000
+
+struct task {
+  int producer, seq;
+  struct list_head lnk;
+};
+static struct mpsc_queue Q;
+static struct task Tasks[MPSC_PRODUCERS][MPSC_ITEMS];
+
+void *
+mpsc_producer(void *arg)
+{
+  int p = (int)(size_t)arg;
+  for (int i = 0; i < MPSC_ITEMS; ++i)
+    {
+      Tasks[p][i] = (struct task){.producer = p, .seq = i};
+      mpsc_push (&Q, &(Tasks[p][i].lnk));
+    }
+  return NULL;
+}
+#endif
+
+
 int
 main(void)
 {
@@ -312,6 +670,178 @@ main(void)
       print_data (d);
     }
 
+
+#ifdef LINK_UNROLLED
+  puts("\n/* unrolled list test ***************************/");
+  /* final order: -50, ..., -1, 0, ..., 299 */
+  struct ulist ul;
+  int *v, expected = -50, ok = 1;
+  INIT_ULIST (ul, int);
+
+  for (int i = 0; i < 300; ++i)
+    *(int *)ulist_push_back (&ul) = i;
+  for (int i = -1; i >= -50; --i)
+    *(int *)ulist_push_front (&ul) = i;
+
+  ulist_for_each (v, &ul)
+    ok &= (*v == expected++);
+  ok &= (expected == 300 && ul.len == 350);
+  printf ("push and iterate: %s\n", ok ? "pass" : "fail");
+
+  /* drop -50,...,-11 and 200,...,299 */
+  for (int i = 0; i < 40; ++i)
+    ulist_pop_front (&ul);
+  for (int i = 0; i < 100; ++i)
+    ulist_pop_back (&ul);
+  ok = (*(int *)ulist_front (&ul) == -10);
+  ok &= (*(int *)ulist_back (&ul) == 199);
+  expected = -10;
+  ulist_for_each (v, &ul)
+    ok &= (*v == expected++);
+  ok &= (expected == 200 && ul.len == 210);
+  printf ("pop: %s\n", ok ? "pass" : "fail");
+
+  /* break leaves the loop, in the middle of a node */
+  expected = 0;
+  ulist_for_each (v, &ul)
+    {
+      if (*v == 100)
+        break;
+      expected++;
+    }
+  ok = (expected == 110 && *v == 100);
+  printf ("break: %s\n", ok ? "pass" : "fail");
+
+  /* cells are aligned for any type */
+  struct ulist ud;
+  INIT_ULIST (ud, long double);
+  for (int i = 0; i < 3; ++i)
+    {
+      long double *d = ulist_push_back (&ud);
+      ok &= (0 == (size_t)d % _Alignof (max_align_t));
+      *d = i;
+    }
+  ulist_destroy (&ud);
+  printf ("alignment: %s\n", ok ? "pass" : "fail");
+
+  while (0 == ulist_pop_back (&ul));
+  ok = (NULL == ulist_front (&ul) && ul.head.next == &ul.head);
+  *(int *)ulist_push_front (&ul) = 7;
+  ok &= (*(int *)ulist_back (&ul) == 7);
+  ulist_destroy (&ul);
+  printf ("empty: %s\n", ok ? "pass" : "fail");
+#endif
+
+
+#ifdef LINK_MPSC
+  puts("\n/* mpsc queue test ******************************/");
+  pthread_t th[MPSC_PRODUCERS];
+  int last[MPSC_PRODUCERS], popped = 0, in_order = 1;
+  struct list_head *e;
+
+  INIT_MPSC_QUEUE (Q);
+  printf ("empty queue: %s\n",
+          (mpsc_empty (&Q) && !mpsc_pop (&Q)) ? "pass" : "fail");
+  for (int i = 0; i < MPSC_PRODUCERS; ++i)
+    {
+      last[i] = -1;
+      pthread_create (&th[i], NULL, mpsc_producer, (void *)(size_t)i);
+    }
+  while (popped < MPSC_PRODUCERS * MPSC_ITEMS)
+    {
+      if (!(e = mpsc_pop (&Q)))
+        {
+          sched_yield ();
+          continue;
+        }
+      struct task *t = container_of (e, struct task, lnk);
+      /* FIFO, per producer */
+      in_order &= (t->seq == last[t->producer] + 1);
+      last[t->producer] = t->seq;
+      popped++;
+    }
+  for (int i = 0; i < MPSC_PRODUCERS; ++i)
+    pthread_join (th[i], NULL);
+  printf ("%d producers: %s\n", MPSC_PRODUCERS,
+          (in_order && mpsc_empty (&Q)) ? "pass" : "fail");
+#endif
+
+  return 0;
+}
+#endif
+
+
+/* the benchmark program */
+#ifdef LINK_BENCH
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#ifndef BENCH_N
+# define BENCH_N (4 * 1000 * 1000)
+#endif
+#ifndef BENCH_ROUNDS
+# define BENCH_ROUNDS 10
+#endif
+
+struct item {
+  long val;
+  struct list_head lnk;
+};
+
+static inline double
+now (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int
+main (void)
+{
+  struct list_head head;
+  struct ulist ul;
+  struct item *it;
+  long *v, sum1 = 0, sum2 = 0;
+  double t;
+
+  INIT_LIST_HEAD (head);
+  INIT_ULIST (ul, long);
+  for (long i = 0; i < BENCH_N; ++i)
+    {
+      it = malloc (sizeof (struct item));
+      it->val = i;
+      link_add_end (&head, &it->lnk);
+      *(long *)ulist_push_back (&ul) = i;
+    }
+
+  t = now ();
+  for (int r = 0; r < BENCH_ROUNDS; ++r)
+    list_for_each_unsafe (it, &head, lnk)
+      sum1 += it->val;
+  t = now () - t;
+  printf ("list_head:  %8.2f M elements/s\n",
+          (double)BENCH_N * BENCH_ROUNDS / t / 1e6);
+
+  t = now ();
+  for (int r = 0; r < BENCH_ROUNDS; ++r)
+    ulist_for_each (v, &ul)
+      sum2 += *v;
+  t = now () - t;
+  printf ("ulist (k=%zu): %8.2f M elements/s\n", ul.k,
+          (double)BENCH_N * BENCH_ROUNDS / t / 1e6);
+
+  if (sum1 != sum2)
+    puts ("fail: different sums");
+
+  struct list_head *p = head.next, *next;
+  for (; p != &head; p = next)
+    {
+      next = p->next;
+      free (container_of (p, struct item, lnk));
+    }
+  ulist_destroy (&ul);
   return 0;
 }
 #endif
@@ -34,6 +34,48 @@
     In other platforms, there is no memory protection,
     and double free can happen with undefined behavior
   
+    Automatic growth:
+      define `PTABLE_AUTOGROW` to make pt_append extend the table
+      (using `ptable_realloc`) instead of returning PT_OVERFLOW
+      as free-list offsets are relative, they remain valid
+      after realloc, so the free slots are still reusable
+      `PT_DO_GROW` defines how the table grows (default: doubles)
+  
+      define `PTABLE_SEGMENTED` to store the table in fixed-size
+      segments of `PT_SEG_LEN` entries (implies PTABLE_AUTOGROW)
+      growing only allocates new segments, so neither indices
+      nor the address of slots change; use pt_seg_init and
+      pt_seg_free instead of pt_alloc and pt_free
+  
+    Occupancy bitmap:
+      define `PTABLE_BITMAP` to keep one bit per slot, maintained by
+      pt_append and pt_delete_byidx, so iterating over live entries
+      (pt_for_each_live) skips free runs 64 slots at a time, with
+      O(live) cost instead of O(capacity)
+      the bitmap is allocated separately (see pt_occ_alloc), and
+      with PTABLE_AUTOGROW it grows along with the table
+      without the bitmap (occ = NULL), the table works as usual,
+      but it has no live entries to iterate over
+  
+    Handle Table (PHTable):
+      a generational version of the table, to be used as
+      an object registry, where each entry is referred to by
+      a handle = [generation | index] instead of a bare index
+      values and generations are stored in separate arrays,
+      a slot is live when its generation is odd, so validating,
+      lookup and removing a handle are O(1) with no guard values
+      and stale handles (of removed entries) are detected, until
+      the 32-bit generation of their slot wraps around, which
+      takes 2^31 reuses of that slot
+  
+    Concurrent Table (PCTable):
+      define `PTABLE_CONCURRENT` (needs C11 atomics) to get a fixed
+      capacity lock-free table, for registering objects from
+      multiple threads without a mutex
+      freed slots are kept in a lock-free stack, its head is tagged
+      by a counter to avoid the ABA problem, values are published
+      with release stores, so readers (pct_get) see initialized data
+  
     Compilation:
       to compile the CLI program:
       cc -ggdb -Wall -Wextra -Werror ptable.c \
@@ -47,6 +89,10 @@
          -D PTABLE_IMPLEMENTATION \
          -D PTABLE_TEST \
          -o test.out
+      pass `-D PTABLE_AUTOGROW` or `-D PTABLE_SEGMENTED`
+      to also test the automatic growth
+      pass `-D PTABLE_BITMAP` to also test the occupancy bitmap
+      pass `-D PTABLE_CONCURRENT -pthread` to also test PCTable
   
       to include in c files:
       ```c
@@ -77,6 +123,7 @@
 #define PTABLE__H__
 #include <string.h>
 #include <sys/types.h>
+#include <stdint.h>
 #include <assert.h>
 
 #ifndef PTDEFF
@@ -86,6 +133,28 @@
 #undef UNUSED
 #define UNUSED(x) ((void)(x))
 
+#ifdef PTABLE_SEGMENTED
+#  ifndef PTABLE_AUTOGROW
+#    define PTABLE_AUTOGROW
+#  endif
+   /* length of segments = 2^PT_SEG_SHIFT entries */
+#  ifndef PT_SEG_SHIFT
+#    define PT_SEG_SHIFT 12
+#  endif
+#  define PT_SEG_LEN ((idx_t)1 << PT_SEG_SHIFT)
+#endif
+
+#ifdef PTABLE_AUTOGROW
+#  ifndef ptable_realloc
+#    include <stdlib.h>
+#    define ptable_realloc(p, news) realloc (p, news)
+#    define ptable_free(p) free (p)
+#  endif
+#  ifndef PT_DO_GROW
+#    define PT_DO_GROW(cap) ((cap) *= 2)
+#  endif
+#endif
+
 /* this value must exist in mem[__lastocc + 1] */
 #if   __SIZEOF_POINTER__ == 8
 #  define ptr_t size_t
@@ -149,6 +218,12 @@ struct ptable_t {
   /* internal fields */
   idx_t __freeidx; /* first free to write index */
   idx_t __lastocc; /* last occupied index */
+#ifdef PTABLE_SEGMENTED
+  idx_t __segcap; /* capacity of mem (segment count) */
+#endif
+#ifdef PTABLE_BITMAP
+  uint64_t *occ; /* occupancy bitmap, 1 -> occupied */
+#endif
 };
 typedef struct ptable_t PTable;
 #define pt_last_idx(pt) ((pt)->__lastocc) /* last occupied index */
@@ -192,7 +267,64 @@ typedef struct ptable_t PTable;
     (ptable)->mem = NULL;                       \
   } while (0)
 
-#define pt_addrof(ptable, index) ((ptable)->mem + index)
+#ifdef PTABLE_BITMAP
+/**
+ *  the same macros for the occupancy bitmap, for instance:
+ *    pt_occ_alloc (&pt, malloc (cap));
+ *    pt_occ_realloc (&pt, realloc (mem, cap));  after pt_realloc
+ *    pt_occ_free (&pt, free (mem));
+ *  pt_occ_realloc zeros the bits after the last occupied slot
+ */
+#define ptocc_sizeof(cap) ((((cap) + 63) >> 6) * sizeof (uint64_t))
+#define pt_occ_sizeof(pt) ptocc_sizeof ((pt)->cap)
+
+#define pt_occ_alloc(ptable, funcall) do {                      \
+    idx_t cap = pt_occ_sizeof (ptable);                         \
+    if (((ptable)->occ = funcall))                              \
+      memset ((ptable)->occ, 0, cap);                           \
+  } while (0)
+#define pt_occ_realloc(ptable, funcall) do {                    \
+    idx_t cap = pt_occ_sizeof (ptable);                         \
+    void *mem = (ptable)->occ;                                  \
+    if (mem && ((ptable)->occ = funcall)) {                     \
+      idx_t __w = ((ptable)->__lastocc >> 6) + 1;               \
+      if (__w * sizeof (uint64_t) < cap)                        \
+        memset ((ptable)->occ + __w, 0,                         \
+                cap - __w * sizeof (uint64_t));                 \
+    }} while (0)
+#define pt_occ_free(ptable, funcall) do {                       \
+    idx_t cap = pt_occ_sizeof (ptable);                         \
+    void *mem = (ptable)->occ;                                  \
+    if (mem && cap > 0) {funcall;}                              \
+    (ptable)->occ = NULL;                                       \
+  } while (0)
+
+#define pt_isoccupied(pt, idx) \
+  (((pt)->occ[(idx) >> 6] >> ((idx) & 63)) & 1)
+
+/**
+ *  iterate over occupied slots of @pt
+ *  @idx: the loop cursor, index of the slot
+ */
+#define pt_for_each_live(pt, idx)                               \
+  for (idx_t idx = pt_next_live (pt, 0);                        \
+       idx != (idx_t)-1;                                        \
+       idx = pt_next_live (pt, idx + 1))
+#endif /* PTABLE_BITMAP */
+
+/**
+ *  access the slot at @index (lvalue)
+ *  in segmented tables, mem[k] is the k'th segment
+ */
+#ifdef PTABLE_SEGMENTED
+#  define pt_slot(ptable, index)                                \
+  (((void **)(ptable)->mem[(index) >> PT_SEG_SHIFT])            \
+   [(index) & (PT_SEG_LEN - 1)])
+#else
+#  define pt_slot(ptable, index) ((ptable)->mem[index])
+#endif
+
+#define pt_addrof(ptable, index) (&pt_slot (ptable, index))
 #define pt_GET(pt, idx, T) ((T *)pt_addrof (pt, idx))
 
 /**
@@ -220,6 +352,38 @@ PTDEFF int pt_delete_byidx (PTable *pt, idx_t idx);
 /* @return: error message */
 PTDEFF const char *pt_strerr (int errnum);
 
+#ifdef PTABLE_BITMAP
+/**
+ *  find the first occupied index >= @idx
+ *  @return: on success    -> the index
+ *           on error/end  -> max value of idx_t (-1)
+ */
+PTDEFF idx_t pt_next_live (const PTable *pt, idx_t idx);
+
+/* @return: number of occupied slots */
+PTDEFF idx_t pt_count_live (const PTable *pt);
+#endif
+
+#ifdef PTABLE_AUTOGROW
+/**
+ *  extend the table, pt_append calls this on overflow
+ *  in segmented tables, it adds one segment
+ *  @return: on success  -> 0
+ *           on failure  -> PT_OVERFLOW (the table is intact)
+ */
+PTDEFF int pt_grow (PTable *pt);
+#endif
+
+#ifdef PTABLE_SEGMENTED
+/**
+ *  allocate segments for at least @pt->cap entries
+ *  @return: same as the pt_grow function
+ */
+PTDEFF int pt_seg_init (PTable *pt);
+/* free all of the segments */
+PTDEFF void pt_seg_free (PTable *pt);
+#endif
+
 /**
  *  stack version
  *  you can use this library also as stack
@@ -227,17 +391,202 @@ PTDEFF const char *pt_strerr (int errnum);
 /* @return: same as the pt_append function */
 #define pt_push(pt, val) pt_append (pt, val)
 /* only get the top of the stack, type: void pointer */
-#define pt_top(pt) (pt->mem[pt->__lastocc])
+#define pt_top(pt) pt_slot (pt, (pt)->__lastocc)
 /**
  *  removes the top of stack and return it
  *  returns NULL when the stack is empty
  */
 PTDEFF void *pt_pop (PTable *pt);
 
+
+/**
+ *  Handle Table
+ *  mem layout:  [values (void *) ... | generations (uint32_t) ...]
+ *  freed slots keep the index of the next free slot in values
+ */
+typedef uint64_t pt_handle_t;
+#define PT_HANDLE_NULL ((pt_handle_t)0)
+#define pt_handle_idx(h) ((idx_t)((h) & 0xFFFFFFFF))
+#define pt_handle_gen(h) ((uint32_t)((h) >> 32))
+#define pt_mkhandle(idx, gen) \
+  (((pt_handle_t)(gen) << 32) | ((pt_handle_t)(idx) & 0xFFFFFFFF))
+
+struct pt_handle_table_t {
+  void **mem; /* values */
+  uint32_t *gens; /* generations, odd -> live */
+  idx_t cap; /* capacity (entry count) */
+  /* internal fields */
+  idx_t __len; /* count of ever used slots */
+  idx_t __freeidx; /* first free slot, -1 -> none */
+};
+typedef struct pt_handle_table_t PHTable;
+
+/* sizeof mem of capacity @cap (in bytes) */
+#define phtmem_sizeof(cap) \
+  ((cap) * (sizeof (void *) + sizeof (uint32_t)))
+#define pht_sizeof(pht) phtmem_sizeof ((pht)->cap)
+#define new_phtable(c) (PHTable){.cap = c,              \
+      .__len = 0, .__freeidx = (idx_t)-1,               \
+      .mem = NULL, .gens = NULL                         \
+      }
+
+/**
+ *  alloc and free macros, the same as pt_alloc and pt_free
+ *    pht_alloc (&pht, malloc (cap));
+ *    pht_free (&pht, free (mem));
+ */
+#define pht_alloc(phtable, funcall) do {                        \
+    idx_t cap = pht_sizeof (phtable);                           \
+    (phtable)->mem = funcall;                                   \
+    if ((phtable)->mem) {                                       \
+      (phtable)->gens = (uint32_t *)((phtable)->mem             \
+                                     + (phtable)->cap);         \
+      memset ((phtable)->gens, 0,                               \
+              (phtable)->cap * sizeof (uint32_t));              \
+    }} while (0)
+#define pht_free(phtable, funcall) do {                         \
+    idx_t cap = pht_sizeof (phtable);                           \
+    void *mem = (phtable)->mem;                                 \
+    if (mem && cap > 0) {funcall;}                              \
+    (phtable)->mem = NULL;                                      \
+    (phtable)->gens = NULL;                                     \
+  } while (0)
+
+/* O(1) handle validation */
+#define pht_isvalid(pht, h)                                     \
+  (pt_handle_idx (h) < (pht)->__len &&                          \
+   (pht)->gens[pt_handle_idx (h)] == pt_handle_gen (h) &&       \
+   (pt_handle_gen (h) & 1))
+
+/**
+ *  insert @value to the handle table
+ *  @return: on success  -> handle of the @value
+ *           on failure  -> PT_HANDLE_NULL (table is full)
+ */
+PTDEFF pt_handle_t pht_insert (PHTable *pht, void *value);
+
+/**
+ *  lookup the handle @h
+ *  @return: the value, NULL if @h is stale or invalid
+ */
+PTDEFF void *pht_get (const PHTable *pht, pt_handle_t h);
+
+/**
+ *  remove the handle @h, @h and its copies become stale
+ *  (until the generation of the slot wraps, see the top of this file)
+ *  @return: on success  -> 0
+ *           on failure  -> PT_ALREADY_FREED for stale handles
+ */
+PTDEFF int pht_remove (PHTable *pht, pt_handle_t h);
+
+
+#ifdef PTABLE_CONCURRENT
+#include <stdatomic.h>
+/**
+ *  Concurrent Table
+ *  mem layout:  [values (void *) ... | links (uint32_t) ...]
+ *  links[i] is the next free slot of the freed slot i
+ *  freed and never used slots hold PT_CFREE as value, an address
+ *  that no object can have, the same in all translation units,
+ *  so any pointer can be stored, but NULL is not accepted,
+ *  as pct_get returns NULL for free slots
+ */
+#define PT_CNIL (0xFFFFFFFF) /* end of free slots stack */
+#define PT_CFREE ((void *)UINTPTR_MAX) /* value of free slots */
+
+struct pt_conc_table_t {
+  _Atomic (void *) *mem; /* values */
+  _Atomic uint32_t *links;
+  idx_t cap; /* capacity (entry count) */
+  /* internal fields */
+  _Atomic uint64_t __freehead; /* [tag | index] */
+  _Atomic uint32_t __len; /* count of ever used slots */
+};
+typedef struct pt_conc_table_t PCTable;
+
+/* sizeof mem of capacity @cap (in bytes) */
+#define pctmem_sizeof(cap) \
+  ((cap) * (sizeof (void *) + sizeof (uint32_t)))
+#define pct_sizeof(pct) pctmem_sizeof ((pct)->cap)
+#define new_pctable(c) (PCTable){.cap = c,      \
+      .__freehead = PT_CNIL, .__len = 0,        \
+      .mem = NULL, .links = NULL                \
+      }
+
+/**
+ *  alloc and free macros, the same as pt_alloc and pt_free
+ *  they are not thread-safe
+ *    pct_alloc (&pct, malloc (cap));
+ *    pct_free (&pct, free (mem));
+ */
+#define pct_alloc(pctable, funcall) do {                        \
+    idx_t cap = pct_sizeof (pctable);                           \
+    (pctable)->mem = funcall;                                   \
+    if ((pctable)->mem) {                                       \
+      (pctable)->links = (_Atomic uint32_t *)                   \
+        ((pctable)->mem + (pctable)->cap);                      \
+      __pct_init (pctable);                                     \
+    }} while (0)
+#define pct_free(pctable, funcall) do {                         \
+    idx_t cap = pct_sizeof (pctable);                           \
+    void *mem = (pctable)->mem;                                 \
+    if (mem && cap > 0) {funcall;}                              \
+    (pctable)->mem = NULL;                                      \
+    (pctable)->links = NULL;                                    \
+  } while (0)
+
+/* internal, marks all slots as free, used by pct_alloc */
+PTDEFF void __pct_init (PCTable *pct);
+
+/**
+ *  append to the table (thread-safe)
+ *  the index of @value will be stored in @idx
+ *  @value must not be NULL (nor PT_CFREE)
+ *  @return: on success   -> 0
+ *           on failure   -> PT_OVERFLOW, when the table is full
+ *                           PT_NULLPTR, when @value is NULL
+ */
+PTDEFF int pct_append (PCTable *pct, void *value, idx_t *idx);
+
+/**
+ *  delete an element by index (thread-safe)
+ *  @return: on success  -> 0
+ *           on failure  -> PT_ALREADY_FREED, PT_IDX_OUTOF_BOUND
+ */
+PTDEFF int pct_delete_byidx (PCTable *pct, idx_t idx);
+
+/**
+ *  get the element at @idx (thread-safe)
+ *  @return: the value, NULL if the slot is free
+ */
+PTDEFF void *pct_get (PCTable *pct, idx_t idx);
+#endif /* PTABLE_CONCURRENT */
+
 #endif /* PTABLE__H__ */
 
 #ifdef PTABLE_IMPLEMENTATION
 
+/* internal, to check table overflow (and grow) after append */
+#ifdef PTABLE_AUTOGROW
+#  define __pt_isfull(pt) \
+  ((pt)->__lastocc + 1 >= (pt)->cap && 0 != pt_grow (pt))
+#else
+#  define __pt_isfull(pt) ((pt)->__lastocc + 1 >= (pt)->cap)
+#endif
+
+/* internal, to maintain the occupancy bitmap, if any */
+#ifdef PTABLE_BITMAP
+#  define __pt_occ_set(pt, idx) do { if ((pt)->occ)               \
+      (pt)->occ[(idx) >> 6] |= (uint64_t)1 << ((idx) & 63);       \
+  } while (0)
+#  define __pt_occ_clear(pt, idx) do { if ((pt)->occ)             \
+      (pt)->occ[(idx) >> 6] &= ~((uint64_t)1 << ((idx) & 63));    \
+  } while (0)
+#else
+#  define __pt_occ_set(pt, idx) do {} while (0)
+#  define __pt_occ_clear(pt, idx) do {} while (0)
+#endif
+
 PTDEFF const char *
 pt_strerr (int errnum)
 {
@@ -271,7 +620,7 @@ pt_pop (PTable *pt)
 {
   if (pt->__lastocc == 0 && pt->__freeidx == 0)
     return NULL;
-  void *ret = pt->mem[pt->__lastocc];
+  void *ret = pt_slot (pt, pt->__lastocc);
   pt_delete_byidx (pt, pt->__lastocc);
   return ret;
 }
@@ -288,20 +637,21 @@ pt_append (PTable *pt, void *value)
       if (pt->__lastocc > 0 && pt->__lastocc > pt->__freeidx)
         {
           if (pt->__lastocc + 1 < pt->cap &&
-              pt->mem[pt->__lastocc + 1] != (void *)SLOT_GUARD)
+              pt_slot (pt, pt->__lastocc + 1) != (void *)SLOT_GUARD)
             return PT_MEM_SMASHING;
         }
       /* write on unused indices */
       pt->__lastocc = pt->__freeidx;
-      pt->mem[pt->__freeidx] = value;
+      pt_slot (pt, pt->__freeidx) = value;
+      __pt_occ_set (pt, pt->__freeidx);
       pt->__freeidx++;
-      if (pt->__lastocc + 1 >= pt->cap)
+      if (__pt_isfull (pt))
         return PT_OVERFLOW;
     }
   else
     {
       /* write on freed indices */
-      off_t _offset = (off_t)pt->mem[pt->__freeidx];
+      off_t _offset = (off_t)pt_slot (pt, pt->__freeidx);
 #ifdef HAVE_DFREE_PROTECTION
       if (MEMPROTO_FLAG (_offset) != SLOT_GUARD_H)
         {
@@ -316,15 +666,16 @@ pt_append (PTable *pt, void *value)
           return PT_DOUBLEFREE;
         }
       assert (pt->__freeidx < pt->__lastocc && "Broken Logic");
-      pt->mem[pt->__freeidx] = value;
+      pt_slot (pt, pt->__freeidx) = value;
+      __pt_occ_set (pt, pt->__freeidx);
       if (pt->__freeidx >= pt->__lastocc)
         pt->__lastocc = pt->__freeidx;
       pt->__freeidx += _offset;
     }
   /* write the gaurd */
-  if (pt->__lastocc < pt->cap)
-    pt->mem[pt->__lastocc + 1] = (void *)SLOT_GUARD;
-  if (pt->__lastocc + 1 >= pt->cap)
+  if (pt->__lastocc + 1 < pt->cap)
+    pt_slot (pt, pt->__lastocc + 1) = (void *)SLOT_GUARD;
+  if (__pt_isfull (pt))
     return PT_OVERFLOW;
 
   return 0;
@@ -347,16 +698,17 @@ pt_delete_byidx (PTable *pt, idx_t idx)
   ptr_t value = pt->__freeidx - idx;
   value = MEMPROTO_TO (value);
 
-  if (MEMPROTO_FLAG ((ptr_t)pt->mem[idx]) == SLOT_GUARD_H)
+  if (MEMPROTO_FLAG ((ptr_t)pt_slot (pt, idx)) == SLOT_GUARD_H)
     {
       /* prevent double free */
       return PT_ALREADY_FREED;
     }
-  pt->mem[idx] = (void *)value;
+  pt_slot (pt, idx) = (void *)value;
 #else
-  pt->mem[idx] = (void*)(pt->__freeidx - idx);
+  pt_slot (pt, idx) = (void*)(pt->__freeidx - idx);
 #endif
 
+  __pt_occ_clear (pt, idx);
   pt->__freeidx = idx;
   if (pt->__freeidx == pt->__lastocc && pt->__lastocc > 0)
     pt->__lastocc--;
@@ -374,7 +726,7 @@ pt_prev_free_idx (PTable *pt, idx_t idx)
   if (pt->__freeidx >= pt->__lastocc)
     return -1;
 
-  off_t _offset = (off_t)pt->mem[idx];
+  off_t _offset = (off_t)pt_slot (pt, idx);
 
 #ifdef HAVE_DFREE_PROTECTION
   if (SLOT_GUARD_H != MEMPROTO_FLAG (_offset))
@@ -400,6 +752,327 @@ pt_prev_free_idx (PTable *pt, idx_t idx)
     return -1;
   return idx;
 }
+
+#ifdef PTABLE_BITMAP
+PTDEFF idx_t
+pt_next_live (const PTable *pt, idx_t idx)
+{
+  if (!pt || !pt->occ || idx > pt->__lastocc)
+    return -1;
+
+  idx_t w = idx >> 6, last = pt->__lastocc >> 6;
+  /* drop bits before @idx in the first word */
+  uint64_t bits = pt->occ[w] & (~(uint64_t)0 << (idx & 63));
+
+  while (0 == bits)
+    {
+      if (++w > last)
+        return -1;
+      bits = pt->occ[w];
+    }
+  return (w << 6) + __builtin_ctzll (bits);
+}
+
+PTDEFF idx_t
+pt_count_live (const PTable *pt)
+{
+  idx_t n = 0;
+
+  if (!pt || !pt->occ)
+    return 0;
+  for (idx_t w = 0; w <= (pt->__lastocc >> 6); ++w)
+    n += __builtin_popcountll (pt->occ[w]);
+  return n;
+}
+#endif /* PTABLE_BITMAP */
+
+#ifdef PTABLE_AUTOGROW
+#ifdef PTABLE_BITMAP
+/* internal, grows the bitmap of @pt for @newcap slots */
+static inline int
+__pt_occ_grow (PTable *pt, idx_t newcap)
+{
+  size_t oldsize = (pt->occ) ? pt_occ_sizeof (pt) : 0;
+  uint64_t *newocc;
+
+  /* no bitmap, unless the table is new (pt_seg_init) */
+  if (!pt->occ && pt->cap > 0)
+    return 0;
+  if (!(newocc = ptable_realloc (pt->occ, ptocc_sizeof (newcap))))
+    return PT_OVERFLOW;
+  memset ((char *)newocc + oldsize, 0, ptocc_sizeof (newcap) - oldsize);
+  pt->occ = newocc;
+  return 0;
+}
+#else
+#  define __pt_occ_grow(pt, newcap) 0
+#endif /* PTABLE_BITMAP */
+
+#ifndef PTABLE_SEGMENTED
+PTDEFF int
+pt_grow (PTable *pt)
+{
+  idx_t newcap = pt->cap;
+  void **newmem;
+
+  PT_DO_GROW (newcap);
+  if (newcap <= pt->cap)
+    return PT_OVERFLOW;
+  if (0 != __pt_occ_grow (pt, newcap))
+    return PT_OVERFLOW;
+  if (!(newmem = ptable_realloc (pt->mem, ptmem_sizeof (newcap))))
+    return PT_OVERFLOW;
+
+  pt->mem = newmem;
+  pt->cap = newcap;
+  return 0;
+}
+
+#else /* PTABLE_SEGMENTED */
+PTDEFF int
+pt_grow (PTable *pt)
+{
+  idx_t seg = pt->cap >> PT_SEG_SHIFT;
+  void *newseg;
+
+  if (seg >= pt->__segcap)
+    {
+      /* only the segment pointers get reallocated */
+      idx_t newsegcap = (pt->__segcap) ? pt->__segcap : 1;
+      void **newmem;
+
+      PT_DO_GROW (newsegcap);
+      if (!(newmem = ptable_realloc (pt->mem, ptmem_sizeof (newsegcap))))
+        return PT_OVERFLOW;
+      pt->mem = newmem;
+      pt->__segcap = newsegcap;
+    }
+  if (0 != __pt_occ_grow (pt, pt->cap + PT_SEG_LEN))
+    return PT_OVERFLOW;
+  if (!(newseg = ptable_realloc (NULL, ptmem_sizeof (PT_SEG_LEN))))
+    return PT_OVERFLOW;
+
+  pt->mem[seg] = newseg;
+  pt->cap += PT_SEG_LEN;
+  return 0;
+}
+
+PTDEFF int
+pt_seg_init (PTable *pt)
+{
+  idx_t want = pt->cap;
+
+  pt->cap = 0;
+  pt->__segcap = 0;
+  pt->mem = NULL;
+#ifdef PTABLE_BITMAP
+  pt->occ = NULL;
+#endif
+  do {
+    if (0 != pt_grow (pt))
+      return PT_OVERFLOW;
+  } while (pt->cap < want);
+
+  return 0;
+}
+
+PTDEFF void
+pt_seg_free (PTable *pt)
+{
+  if (!pt->mem)
+    return;
+  for (idx_t i = 0; i < (pt->cap >> PT_SEG_SHIFT); ++i)
+    ptable_free (pt->mem[i]);
+  ptable_free (pt->mem);
+#ifdef PTABLE_BITMAP
+  ptable_free (pt->occ);
+  pt->occ = NULL;
+#endif
+  pt->mem = NULL;
+  pt->cap = 0;
+  pt->__segcap = 0;
+}
+#endif /* PTABLE_SEGMENTED */
+#endif /* PTABLE_AUTOGROW */
+
+#ifdef PTABLE_AUTOGROW
+/* internal, grows @pht, values and generations move separately */
+static inline int
+__pht_grow (PHTable *pht)
+{
+  idx_t newcap = pht->cap;
+  void **newmem;
+
+  PT_DO_GROW (newcap);
+  if (newcap <= pht->cap || (uint64_t)newcap > 0xFFFFFFFF)
+    return PT_OVERFLOW;
+  if (!(newmem = ptable_realloc (pht->mem, phtmem_sizeof (newcap))))
+    return PT_OVERFLOW;
+
+  uint32_t *newgens = (uint32_t *)(newmem + newcap);
+  memmove (newgens, newmem + pht->cap, pht->cap * sizeof (uint32_t));
+  memset (newgens + pht->cap, 0,
+          (newcap - pht->cap) * sizeof (uint32_t));
+
+  pht->mem = newmem;
+  pht->gens = newgens;
+  pht->cap = newcap;
+  return 0;
+}
+#endif /* PTABLE_AUTOGROW */
+
+PTDEFF pt_handle_t
+pht_insert (PHTable *pht, void *value)
+{
+  idx_t idx;
+
+  if (!pht || !pht->mem)
+    return PT_HANDLE_NULL;
+
+  if (pht->__freeidx != (idx_t)-1)
+    {
+      /* reuse freed slots */
+      idx = pht->__freeidx;
+      pht->__freeidx = (idx_t)pht->mem[idx];
+    }
+  else
+    {
+#ifdef PTABLE_AUTOGROW
+      if (pht->__len >= pht->cap && 0 != __pht_grow (pht))
+        return PT_HANDLE_NULL;
+#else
+      if (pht->__len >= pht->cap)
+        return PT_HANDLE_NULL;
+#endif
+      idx = pht->__len++;
+    }
+
+  pht->mem[idx] = value;
+  /* even -> odd, the slot is live */
+  pht->gens[idx]++;
+  return pt_mkhandle (idx, pht->gens[idx]);
+}
+
+PTDEFF void *
+pht_get (const PHTable *pht, pt_handle_t h)
+{
+  if (!pht_isvalid (pht, h))
+    return NULL;
+  return pht->mem[pt_handle_idx (h)];
+}
+
+PTDEFF int
+pht_remove (PHTable *pht, pt_handle_t h)
+{
+  if (!pht || !pht->mem)
+    return PT_NULLPTR;
+  if (!pht_isvalid (pht, h))
+    return PT_ALREADY_FREED;
+
+  idx_t idx = pt_handle_idx (h);
+  /* odd -> even, all copies of @h become stale */
+  pht->gens[idx]++;
+  pht->mem[idx] = (void *)pht->__freeidx;
+  pht->__freeidx = idx;
+  return 0;
+}
+
+#ifdef PTABLE_CONCURRENT
+/* internal, [tag | index] of the free slots stack head */
+#define __pct_head(tag, idx) (((uint64_t)(tag) << 32) | (uint32_t)(idx))
+
+PTDEFF void
+__pct_init (PCTable *pct)
+{
+  for (idx_t i = 0; i < pct->cap; ++i)
+    atomic_init (pct->mem + i, PT_CFREE);
+}
+
+PTDEFF int
+pct_append (PCTable *pct, void *value, idx_t *idx)
+{
+  uint64_t head, newhead;
+  uint32_t i, len;
+
+  if (!pct || !pct->mem || !value || PT_CFREE == value)
+    return PT_NULLPTR;
+
+  /* pop a freed slot */
+  head = atomic_load_explicit (&pct->__freehead, memory_order_acquire);
+  do {
+    i = (uint32_t)head;
+    if (PT_CNIL == i)
+      goto unused_slots;
+    /**
+     *  links[i] might be changed by other threads, then
+     *  the tag of the head has also changed and CAS fails
+     */
+    newhead = __pct_head ((head >> 32) + 1,
+                          atomic_load_explicit (pct->links + i,
+                                                memory_order_relaxed));
+  } while (!atomic_compare_exchange_weak_explicit (&pct->__freehead,
+                                                   &head, newhead,
+                                                   memory_order_acq_rel,
+                                                   memory_order_acquire));
+  goto publish;
+
+ unused_slots:
+  /* take a never used slot */
+  len = atomic_load_explicit (&pct->__len, memory_order_relaxed);
+  do {
+    if (len >= pct->cap || len >= PT_CNIL)
+      return PT_OVERFLOW;
+  } while (!atomic_compare_exchange_weak_explicit (&pct->__len,
+                                                   &len, len + 1,
+                                                   memory_order_relaxed,
+                                                   memory_order_relaxed));
+  i = len;
+
+ publish:
+  atomic_store_explicit (pct->mem + i, value, memory_order_release);
+  if (idx)
+    *idx = i;
+  return 0;
+}
+
+PTDEFF int
+pct_delete_byidx (PCTable *pct, idx_t idx)
+{
+  uint64_t head, newhead;
+
+  if (!pct || !pct->mem)
+    return PT_NULLPTR;
+  if (idx >= pct->cap)
+    return PT_IDX_OUTOF_BOUND;
+
+  /* only one of the racing deletes gets the value */
+  if (PT_CFREE == atomic_exchange_explicit (pct->mem + idx, PT_CFREE,
+                                            memory_order_acq_rel))
+    return PT_ALREADY_FREED;
+
+  /* push the slot */
+  head = atomic_load_explicit (&pct->__freehead, memory_order_relaxed);
+  do {
+    atomic_store_explicit (pct->links + idx, (uint32_t)head,
+                           memory_order_relaxed);
+    newhead = __pct_head ((head >> 32) + 1, idx);
+  } while (!atomic_compare_exchange_weak_explicit (&pct->__freehead,
+                                                   &head, newhead,
+                                                   memory_order_release,
+                                                   memory_order_relaxed));
+  return 0;
+}
+
+PTDEFF void *
+pct_get (PCTable *pct, idx_t idx)
+{
+  if (!pct || !pct->mem || idx >= pct->cap)
+    return NULL;
+
+  void *ret = atomic_load_explicit (pct->mem + idx, memory_order_acquire);
+  return (PT_CFREE == ret) ? NULL : ret;
+}
+#endif /* PTABLE_CONCURRENT */
 #endif /* PTABLE_IMPLEMENTATION */
 
 #ifdef PTABLE_TEST
@@ -503,6 +1176,9 @@ main_loop (PTable *pt)
               {
                 pt->cap += BASE_TABLE_SIZE;
                 pt_realloc (pt, realloc (mem, cap));
+#ifdef PTABLE_BITMAP
+                pt_occ_realloc (pt, realloc (mem, cap));
+#endif
                 printf ("table has extended, capacity: %lu\n", pt->cap);
                 ptr -= 0x1111;
                 goto AppendCMD;
@@ -536,7 +1212,7 @@ main_loop (PTable *pt)
                         slot_type = 'f';
                     }
 
-                  off_t val = (off_t)pt->mem[i];
+                  off_t val = (off_t)pt_slot (pt, i);
 #ifdef HAVE_DFREE_PROTECTION
                   /* we only have memory flag for freed slots */
                   if (slot_type == 'f')
@@ -586,7 +1262,7 @@ main_loop (PTable *pt)
           {
             if ((idx = readline_getnumber ("index: ")) >= 0)
               {
-                printf (" table[%ld] = %p\n", idx, pt->mem[idx]);
+                printf (" table[%ld] = %p\n", idx, pt_slot (pt, idx));
               }
           }
           break;
@@ -594,7 +1270,7 @@ main_loop (PTable *pt)
         case 'w':
           if ((idx = readline_getnumber ("index: ")) >= 0)
             {
-              pt->mem[idx] = readline_gethex ("value in hex: ");
+              pt_slot (pt, idx) = readline_gethex ("value in hex: ");
             }
           break;
 
@@ -634,13 +1310,12 @@ typedef struct mem_test_case_t mt_case;
 int
 __do_test__ (PTable *pt, const mt_case tests[], int len)
 {
-  void **mem = pt->mem;
   for (const mt_case *t = &tests[0]; len != 0; --len, ++t)
     {
-      if (mem[t->index] != t->exp_value)
+      if (pt_slot (pt, t->index) != t->exp_value)
         {
           printf ("[test idx:%lu] failed! %p != %p\n",
-                  t->index, mem[t->index], t->exp_value);
+                  t->index, pt_slot (pt, t->index), t->exp_value);
           return -1;
         }
     }
@@ -664,8 +1339,9 @@ __do_test__ (PTable *pt, const mt_case tests[], int len)
 void
 run_tests (PTable *pt)
 {
-  /* memset to zero, for testing purposes */
-  pt_mem (pt, memset (mem, 0, cap));
+  /* set to zero, for testing purposes */
+  for (idx_t i = 0; i < pt->cap; ++i)
+    pt_slot (pt, i) = NULL;
 
   TEST (pt, "test 1  --  append to table",
         {
@@ -703,8 +1379,175 @@ run_tests (PTable *pt)
         MT(1, 8), MT(2, -1), MT(5, -3));
 #  endif /* HAVE_DFREE_PROTECTION */
 #endif /* __SIZEOF_POINTER__ >= 4 */
+
+#ifdef PTABLE_BITMAP
+  /* slots 1, 2, 5 are free */
+  const idx_t exp[] = {0, 3, 4, 6, 7, 8};
+  TEST (pt, "test 3  --  iterate over live entries",
+        {
+          idx_t n = 0;
+          pt_for_each_live (pt, i)
+            {
+              __errno |= (n >= lenof (exp) || exp[n] != i);
+              n++;
+            }
+          __errno |= (n != lenof (exp));
+          __errno |= (pt_count_live (pt) != lenof (exp));
+          __errno |= (pt_next_live (pt, 5) != 6);
+          __errno |= (pt_next_live (pt, 9) != (idx_t)-1);
+#  ifndef PTABLE_SEGMENTED
+          /* without pt_occ_alloc, nothing is live */
+          PTable nb = new_ptable (4);
+          pt_alloc (&nb, malloc (cap));
+#    ifdef PTABLE_AUTOGROW
+          const int nb_len = 9; /* grows */
+#    else
+          const int nb_len = 3;
+#    endif
+          for (ptr_t i = 1; i <= (ptr_t)nb_len; ++i)
+            __errno |= pt_append (&nb, (void *)i);
+          __errno |= pt_delete_byidx (&nb, 1);
+          __errno |= (NULL != nb.occ || 0 != pt_count_live (&nb));
+          __errno |= (pt_next_live (&nb, 0) != (idx_t)-1);
+          pt_free (&nb, free (mem));
+#  endif
+        },
+        MT(6, 0x666), MT(8, 0x888));
+#endif /* PTABLE_BITMAP */
+
+#ifdef PTABLE_AUTOGROW
+  TEST (pt, "test 4  --  automatic growth",
+        {
+          /* fill the freed slots, then append beyond the capacity */
+          idx_t cap = pt->cap;
+          for (ptr_t i = 0xA00; i < 0xA00 + 3 + cap; ++i)
+            __errno |= pt_append (pt, (void *)i);
+          __errno |= !(pt->cap > cap);
+          __errno |= !(pt_last_idx (pt) == 8 + cap);
+          __errno |= pt_slot (pt, 8 + cap) != (void *)(0xA02 + cap);
+          __errno |= pt_slot (pt, 9 + cap) != (void *)SLOT_GUARD;
+#  ifdef PTABLE_BITMAP
+          __errno |= pt_count_live (pt) != 9 + cap;
+#  endif
+        },
+        /* freed slots were reused, in LIFO order */
+        MT(5, 0xA00), MT(2, 0xA01), MT(1, 0xA02),
+        MT(3, 0x333), MT(8, 0x888),
+        /* new entries after index 8 */
+        MT(9, 0xA03), MT(15, 0xA09), MT(16, 0xA0A));
+#endif /* PTABLE_AUTOGROW */
+}
+
+void
+run_handle_tests (void)
+{
+  PHTable pht = new_phtable (4);
+  pht_alloc (&pht, malloc (cap));
+  pt_handle_t h[5];
+  int __errno = 0;
+
+  puts (" * test 5  --  generational handles");
+  for (ptr_t i = 0; i < 4; ++i)
+    h[i] = pht_insert (&pht, (void *)(0x111 * (i + 1)));
+  h[4] = pht_insert (&pht, (void *)0x555);
+#ifdef PTABLE_AUTOGROW
+  __errno |= !pht_isvalid (&pht, h[4]);
+#else
+  /* table is full */
+  __errno |= (PT_HANDLE_NULL != h[4]);
+#endif
+  __errno |= pht_get (&pht, h[2]) != (void *)0x333;
+
+  /* h[1] becomes stale, and its slot will be reused */
+  __errno |= pht_remove (&pht, h[1]);
+  __errno |= PT_ALREADY_FREED != pht_remove (&pht, h[1]);
+  __errno |= NULL != pht_get (&pht, h[1]);
+
+  pt_handle_t h1 = pht_insert (&pht, (void *)0xAAA);
+  __errno |= pt_handle_idx (h1) != pt_handle_idx (h[1]);
+  __errno |= NULL != pht_get (&pht, h[1]);
+  __errno |= pht_get (&pht, h1) != (void *)0xAAA;
+  __errno |= pht_get (&pht, h[3]) != (void *)0x444;
+  __errno |= pht_isvalid (&pht, PT_HANDLE_NULL);
+
+  puts (__errno ? "fail" : "pass\n");
+  pht_free (&pht, free (mem));
+}
+
+#ifdef PTABLE_CONCURRENT
+#include <pthread.h>
+
+#define CT_THREADS 4
+#define CT_ROUNDS 64
+#define CT_BATCH 256
+
+struct ct_arg_t {
+  PCTable *pct;
+  ptr_t id;
+  int err;
+};
+
+void *
+__conc_worker (void *arg)
+{
+  struct ct_arg_t *a = arg;
+  idx_t idx[CT_BATCH];
+
+  for (int r = 0; r < CT_ROUNDS; ++r)
+    {
+      for (ptr_t i = 0; i < CT_BATCH; ++i)
+        a->err |= pct_append (a->pct, (void *)(a->id << 16 | i), idx + i);
+      /* nobody else must have our slots */
+      for (ptr_t i = 0; i < CT_BATCH; ++i)
+        a->err |= pct_get (a->pct, idx[i]) != (void *)(a->id << 16 | i);
+      for (ptr_t i = 0; i < CT_BATCH; ++i)
+        a->err |= pct_delete_byidx (a->pct, idx[i]);
+    }
+  return NULL;
 }
 
+void
+run_concurrent_tests (void)
+{
+  PCTable pct = new_pctable (CT_THREADS * CT_BATCH);
+  pct_alloc (&pct, malloc (cap));
+  pthread_t th[CT_THREADS];
+  struct ct_arg_t args[CT_THREADS];
+  int __errno = 0;
+  idx_t idx;
+
+  puts (" * test 6  --  concurrent append and delete");
+  for (int i = 0; i < CT_THREADS; ++i)
+    {
+      args[i] = (struct ct_arg_t){.pct = &pct, .id = i + 1, .err = 0};
+      pthread_create (th + i, NULL, __conc_worker, args + i);
+    }
+  for (int i = 0; i < CT_THREADS; ++i)
+    {
+      pthread_join (th[i], NULL);
+      __errno |= args[i].err;
+    }
+
+  /* all slots must be free and reusable, then the table is full */
+  for (idx_t i = 0; i < pct.cap; ++i)
+    __errno |= NULL != pct_get (&pct, i);
+  for (idx_t i = 0; i < pct.cap; ++i)
+    __errno |= pct_append (&pct, (void *)0x111, &idx);
+  __errno |= PT_OVERFLOW != pct_append (&pct, (void *)0x222, &idx);
+  __errno |= pct_delete_byidx (&pct, 7);
+  __errno |= PT_ALREADY_FREED != pct_delete_byidx (&pct, 7);
+  /* SLOT_GUARD is a valid value, NULL and PT_CFREE are rejected */
+  __errno |= PT_NULLPTR != pct_append (&pct, NULL, &idx);
+  __errno |= PT_NULLPTR != pct_append (&pct, PT_CFREE, &idx);
+  __errno |= pct_append (&pct, (void *)SLOT_GUARD, &idx);
+  __errno |= (void *)SLOT_GUARD != pct_get (&pct, idx);
+  __errno |= pct_delete_byidx (&pct, idx);
+
+  puts (__errno ? "fail" : "pass\n");
+  pct_free (&pct, free (mem));
+}
+#endif /* PTABLE_CONCURRENT */
+
 #endif /* PTABLE_TEST */
 
 
@@ -712,7 +1555,14 @@ int
 main (void)
 {
   PTable pt = new_ptable (BASE_TABLE_SIZE); /* 16 entries */
+#ifdef PTABLE_SEGMENTED
+  pt_seg_init (&pt);
+#else
   pt_alloc (&pt, malloc (cap));
+#  ifdef PTABLE_BITMAP
+  pt_occ_alloc (&pt, malloc (cap));
+#  endif
+#endif
 
 #ifdef PTABLE_CLI
   /* CLI program */
@@ -727,9 +1577,20 @@ main (void)
 #else
   /* normal test */
   run_tests (&pt);
+  run_handle_tests ();
+#ifdef PTABLE_CONCURRENT
+  run_concurrent_tests ();
+#endif
 #endif
   
+#ifdef PTABLE_SEGMENTED
+  pt_seg_free (&pt);
+#else
   pt_free (&pt, free (mem));
+#  ifdef PTABLE_BITMAP
+  pt_occ_free (&pt, free (mem));
+#  endif
+#endif
   return 0;
 }
 
@@ -15,12 +15,51 @@
         time: O(n), n = number of requested bytes to read/write
         mem:  O(1)
   
+    Concurrent rings:
+      define `RB_CONCURRENT` (needs C11 atomics) to get lock-free
+      producer/consumer rings, unlike RBuffer, they never overwrite
+      the unread data, the head and tail are on separate cache lines
+      RBSpsc:  single producer single consumer byte ring
+               capacity must be a power of 2
+      RBMpmc:  multi producer multi consumer ring of fixed-size
+               cells, each cell has a sequence number
+               capacity (cell count) must be a power of 2
+      both have non-blocking, blocking (_wait) and batch calls
+  
+    Mirrored ring:
+      define `RB_MIRROR` (Linux only, needs _GNU_SOURCE for memfd)
+      and use rb_mirror_map to map one memfd twice, back to back
+      so mem[i] and mem[i + cap] are the same byte, and any region
+      of up to cap bytes is contiguous in virtual memory
+      then rb_writen, rb_readn and rb_fwrite do a single copy, and
+      the ring's content can be scanned in place (see rb_data)
+  
+    Record ring:
+      RBRecord stores length-prefixed records, records are never
+      split (neither by the end of the ring nor by overwriting),
+      on overflow, the oldest records are evicted as a whole
+      writes can be done in two phases, rbr_reserve gives space
+      to be filled in place, then rbr_commit publishes it
+      rbr_peekn and rbr_dropn read and consume in batches
+      the memory must be 4-byte aligned
+  
+    File descriptor IO:
+      rb_read_fd and rb_write_fd move data between a file descriptor
+      and the ring directly, using readv/writev on the (at most two)
+      contiguous spans of the ring, define `RB_NO_FDIO` to disable
+      define `RB_SPLICE` (Linux only, needs _GNU_SOURCE) to also get
+      rb_splice_fd, it gives the ring's pages to a pipe (vmsplice)
+      and splices them to the destination without copying
+  
     Compilation:
       to compile the test program:
         cc -ggdb -Wall -Wextra -Werror \
           -D RB_IMPLEMENTATION \
           -D RB_TEST \
           -o test.out ring_buffer.c
+      pass `-D RB_CONCURRENT -pthread` to also test the concurrent rings
+      pass `-D_GNU_SOURCE -D RB_MIRROR` to also test the mirrored ring
+      pass `-D_GNU_SOURCE -D RB_SPLICE` to also test rb_splice_fd
   
       to compile the example program:
         cc -ggdb -Wall -Wextra -Werror \
@@ -40,6 +79,11 @@
 #  include <stdio.h>
 #endif
 
+#ifndef RB_NO_FDIO
+#  define HAVE_FDIO
+#  include <sys/types.h>
+#endif
+
 #ifndef RINGDEF
 #  define RINGDEF static inline
 #endif
@@ -60,13 +104,15 @@ struct ring_buffer {
   size_t cap;
   size_t head, idx;
   bool full;
+  bool mirror; /* mem is mapped twice (see rb_mirror_map) */
 };
 typedef struct ring_buffer RBuffer;
 
 #define rb_new(buf, len) (RBuffer) {                            \
       .mem = buf,                                               \
       .cap = len,                                               \
-      .head = 0, .idx = 0, .full = false                        \
+      .head = 0, .idx = 0, .full = false,                       \
+      .mirror = false                                           \
    }
 
 /* reset the ring */
@@ -93,6 +139,13 @@ typedef struct ring_buffer RBuffer;
     dest[n] = 0;                  \
   } while (0)
 
+/**
+ *  the oldest byte of the ring and the length of its data
+ *  only in mirrored rings, rb_data is contiguous for rb_datalen bytes
+ */
+#define rb_data(r) ((r)->mem + (r)->head)
+#define rb_datalen(r) ((r)->full ? (r)->cap : (r)->idx)
+
 /* write null-terminated string to ring */
 #define rb_writes(ring, src) rb_writen (ring, src, strlen (src))
 /* write to ring */
@@ -104,6 +157,37 @@ RINGDEF void rb_writen (RBuffer *r, const char *src, size_t len);
 RINGDEF void rb_fwrite (RBuffer *r, FILE *f, size_t len);
 #endif
 
+#ifdef HAVE_FDIO
+/**
+ *  read up to @len bytes from @fd into the ring (like rb_fwrite)
+ *  @return: number of bytes read, -1 on error (errno is set)
+ */
+RINGDEF ssize_t rb_read_fd (RBuffer *r, int fd, size_t len);
+
+/**
+ *  write the first @n bytes of the ring's data (like rb_readn) to @fd
+ *  it does not remove the written data from the ring
+ *  @return: number of bytes written, -1 on error (errno is set)
+ */
+RINGDEF ssize_t rb_write_fd (RBuffer *r, int fd, size_t n);
+#endif
+
+#ifdef RB_SPLICE
+/**
+ *  like rb_write_fd, but the data goes through @pipefd
+ *  (an empty pipe) by vmsplice and splice, without being copied
+ *  the ring must not be written until the data is consumed
+ *  by the destination @fd (e.g. a socket might still send them)
+ *  after an error, or when fewer than @n bytes are written,
+ *  the rest of the data might be left in the pipe, so it must be
+ *  drained or recreated before the next call
+ *  @return: number of bytes written to @fd,
+ *           -1 when nothing is written (errno is set)
+ */
+RINGDEF ssize_t rb_splice_fd (RBuffer *r, int fd, size_t n,
+                              int pipefd[2]);
+#endif
+
 /* function definitions */
 
 /* read one byte from the ring @r */
@@ -115,10 +199,247 @@ RINGDEF void rb_readc (RBuffer *r, char *dest);
  */
 RINGDEF void rb_readn (RBuffer *r, size_t n, char dest[n]);
 
+/**
+ *  Record ring
+ *  each record:  [length (uint32_t) | data | padding to 4 bytes]
+ *  when a record doesn't fit at the end of mem, it goes to
+ *  the beginning and a wrap mark (RBR_WRAP) is written instead
+ */
+#include <stdint.h>
+#define RBR_WRAP (0xFFFFFFFF)
+#define RBR_HDR sizeof (uint32_t)
+/* size of a record with @n bytes of data (in mem) */
+#define rbr_sizeof(n) \
+  ((RBR_HDR + (n) + RBR_HDR - 1) & ~(RBR_HDR - 1))
+
+struct rb_record_t {
+  char *mem;
+  size_t cap;
+  size_t head, tail; /* oldest record, next write offsets */
+  size_t count; /* number of records */
+  /* internal, the reserved record */
+  size_t __wpos, __wlen;
+};
+typedef struct rb_record_t RBRecord;
+
+struct rb_slice_t {
+  const char *data;
+  size_t len;
+};
+typedef struct rb_slice_t RBSlice;
+
+#define rbr_new(buf, len) (RBRecord) {                          \
+      .mem = buf, .cap = len,                                   \
+      .head = 0, .tail = 0, .count = 0,                         \
+   }
+#define rbr_reset(r) ((r)->head = (r)->tail = (r)->count = 0)
+
+/**
+ *  reserve space for a record of @n bytes, evicts the
+ *  oldest records when needed
+ *  @return: pointer to fill in place, NULL when @n is too large
+ */
+RINGDEF char *rbr_reserve (RBRecord *r, size_t n);
+/* publish the reserved record, with @n <= reserved bytes */
+RINGDEF void rbr_commit (RBRecord *r, size_t n);
+/* reserve, copy and commit */
+RINGDEF bool rbr_write (RBRecord *r, const char *src, size_t n);
+
+/**
+ *  get up to @n oldest records, without consuming them
+ *  the slices point to the ring's memory, they are valid
+ *  until the next write
+ *  @return: number of records
+ */
+RINGDEF size_t rbr_peekn (RBRecord *r, RBSlice out[], size_t n);
+/* consume (drop) up to @n oldest records */
+RINGDEF void rbr_dropn (RBRecord *r, size_t n);
+
+#ifdef RB_MIRROR
+/**
+ *  maps a ring of capacity @cap, rounded up to the page size
+ *  @return: 0 on success, -1 on failure (errno is set)
+ */
+RINGDEF int rb_mirror_map (RBuffer *r, size_t cap);
+RINGDEF int rb_mirror_unmap (RBuffer *r);
+#endif /* RB_MIRROR */
+
+
+#ifdef RB_CONCURRENT
+#include <stdatomic.h>
+#include <stdalign.h>
+#include <sched.h>
+
+#ifndef RB_CACHELINE
+#  define RB_CACHELINE 64
+#endif
+/* what to do while waiting in blocking calls */
+#ifndef rb_relax
+#  define rb_relax() sched_yield ()
+#endif
+
+/**
+ *  SPSC ring
+ *  head and tail only increase, index = pos & (cap - 1)
+ *  each side caches the other side's position,
+ *  so it only touches the other cache line when needed
+ */
+struct rb_spsc_t {
+  char *mem;
+  size_t cap;
+  /* consumer side */
+  alignas (RB_CACHELINE) _Atomic size_t head;
+  size_t __tail_cache;
+  /* producer side */
+  alignas (RB_CACHELINE) _Atomic size_t tail;
+  size_t __head_cache;
+};
+typedef struct rb_spsc_t RBSpsc;
+
+/* @len must be a power of 2 */
+#define rb_spsc_new(buf, len) (RBSpsc) {.mem = buf, .cap = len}
+/* number of bytes ready to read (approximate) */
+#define rb_spsc_size(r)                                         \
+  (atomic_load_explicit (&(r)->tail, memory_order_acquire)      \
+   - atomic_load_explicit (&(r)->head, memory_order_acquire))
+
+/**
+ *  non-blocking write/read, only the producer thread
+ *  may write and only the consumer thread may read
+ *  @return: number of bytes written/read, might be < @len
+ */
+RINGDEF size_t rb_spsc_write (RBSpsc *r, const char *src, size_t len);
+RINGDEF size_t rb_spsc_read (RBSpsc *r, char *dest, size_t len);
+
+/* blocking versions, wait until all of @len bytes are done */
+RINGDEF void rb_spsc_write_wait (RBSpsc *r, const char *src, size_t len);
+RINGDEF void rb_spsc_read_wait (RBSpsc *r, char *dest, size_t len);
+
+
+/**
+ *  MPMC ring
+ *  mem:  @cap cells of [sequence (size_t) | data (@cell bytes)]
+ *  sequence of a cell tells whether it's ready for
+ *  the producers (seq == pos) or consumers (seq == pos + 1)
+ */
+struct rb_mpmc_t {
+  char *mem;
+  size_t cap; /* cell count */
+  size_t cell; /* size of each cell (bytes) */
+  /* consumers */
+  alignas (RB_CACHELINE) _Atomic size_t head;
+  /* producers */
+  alignas (RB_CACHELINE) _Atomic size_t tail;
+};
+typedef struct rb_mpmc_t RBMpmc;
+
+/* internal, size of each cell plus its sequence number */
+#define __rb_mpmc_stride(cell)                                  \
+  ((sizeof (size_t) + (cell) + sizeof (size_t) - 1)             \
+   & ~(sizeof (size_t) - 1))
+/* sizeof mem of @n cells of @cell bytes */
+#define rb_mpmc_sizeof(n, cell) ((n) * __rb_mpmc_stride (cell))
+
+/* @n must be a power of 2, call rb_mpmc_init after this */
+#define rb_mpmc_new(buf, n, cell_size) (RBMpmc) {               \
+      .mem = buf, .cap = n, .cell = cell_size                   \
+   }
+/* initializes sequence numbers, it's not thread-safe */
+RINGDEF void rb_mpmc_init (RBMpmc *q);
+
+/**
+ *  non-blocking push/pop of one cell
+ *  @return: false when the ring is full/empty
+ */
+RINGDEF bool rb_mpmc_push (RBMpmc *q, const void *cell);
+RINGDEF bool rb_mpmc_pop (RBMpmc *q, void *cell);
+
+/**
+ *  batch push/pop of up to @n cells (array of cells)
+ *  claims all the cells at once
+ *  @return: number of cells pushed/popped
+ */
+RINGDEF size_t rb_mpmc_pushn (RBMpmc *q, const void *cells, size_t n);
+RINGDEF size_t rb_mpmc_popn (RBMpmc *q, void *cells, size_t n);
+
+/* blocking versions */
+RINGDEF void rb_mpmc_push_wait (RBMpmc *q, const void *cell);
+RINGDEF void rb_mpmc_pop_wait (RBMpmc *q, void *cell);
+#endif /* RB_CONCURRENT */
+
 #endif /* RIBG_BUFFER__H__ */
 
 
 #ifdef RB_IMPLEMENTATION
+/* internal, moves the index of ring @r forward, @n <= cap */
+static inline void
+__rb_advance (RBuffer *r, size_t n)
+{
+  r->idx += n;
+  if (r->idx >= r->cap)
+    {
+      r->idx -= r->cap;
+      r->full = true;
+    }
+  if (r->full)
+    r->head = r->idx;
+}
+
+#ifdef RB_MIRROR
+#include <unistd.h>
+#include <sys/mman.h>
+
+RINGDEF int
+rb_mirror_map (RBuffer *r, size_t cap)
+{
+  size_t pg = sysconf (_SC_PAGESIZE);
+  char *base;
+  int fd;
+
+  cap = (cap + pg - 1) / pg * pg;
+  if (0 == cap)
+    cap = pg;
+  if (0 > (fd = memfd_create ("ring_buffer", MFD_CLOEXEC)))
+    return -1;
+  if (0 != ftruncate (fd, cap))
+    goto close_fd;
+
+  /* reserve 2*cap of address space, then map the memfd on it twice */
+  base = mmap (NULL, 2 * cap, PROT_NONE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (MAP_FAILED == base)
+    goto close_fd;
+  if (MAP_FAILED == mmap (base, cap, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_FIXED, fd, 0) ||
+      MAP_FAILED == mmap (base + cap, cap, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_FIXED, fd, 0))
+    {
+      munmap (base, 2 * cap);
+      goto close_fd;
+    }
+  close (fd);
+
+  *r = rb_new (base, cap);
+  r->mirror = true;
+  return 0;
+
+ close_fd:
+  close (fd);
+  return -1;
+}
+
+RINGDEF int
+rb_mirror_unmap (RBuffer *r)
+{
+  if (!r->mirror || NULL == r->mem)
+    return -1;
+  int ret = munmap (r->mem, 2 * r->cap);
+  r->mem = NULL;
+  r->mirror = false;
+  return ret;
+}
+#endif /* RB_MIRROR */
+
 RINGDEF void
 rb_writec (RBuffer *r, char c)
 {
@@ -138,6 +459,21 @@ rb_writen (RBuffer *r, const char *src, size_t len)
 {
   size_t __rest;
 
+#ifdef RB_MIRROR
+  if (r->mirror)
+    {
+      if (len > r->cap)
+        {
+          src += len - r->cap;
+          len = r->cap;
+        }
+      /* might continue on the second mapping */
+      memcpy (r->mem + r->idx, src, len);
+      __rb_advance (r, len);
+      return;
+    }
+#endif
+
   if (len <= r->cap)
     {
       __rest = MIN (len, r->cap - r->idx);
@@ -183,6 +519,14 @@ rb_readn (RBuffer *r, size_t n, char dest[n])
 {
   size_t __rest;
 
+#ifdef RB_MIRROR
+  if (r->mirror)
+    {
+      memcpy (dest, rb_data (r), MIN (n, rb_datalen (r)));
+      return;
+    }
+#endif
+
   if (!r->full)
     {
       __rest = MIN (n, r->idx);
@@ -204,6 +548,114 @@ rb_readn (RBuffer *r, size_t n, char dest[n])
     }
 }
 
+/* internal, length of the record at @off, 0 for wrap marks */
+#define __rbr_len(r, off) (*(uint32_t *)((r)->mem + (off)))
+
+/* internal, skips the end of mem and wrap marks for the head */
+static inline void
+__rbr_fix_head (RBRecord *r)
+{
+  if (r->head + RBR_HDR > r->cap || RBR_WRAP == __rbr_len (r, r->head))
+    r->head = 0;
+}
+
+/* internal, consumes the oldest record */
+static inline void
+__rbr_evict (RBRecord *r)
+{
+  __rbr_fix_head (r);
+  r->head += rbr_sizeof (__rbr_len (r, r->head));
+  if (0 == --r->count)
+    r->head = r->tail = 0;
+}
+
+RINGDEF char *
+rbr_reserve (RBRecord *r, size_t n)
+{
+  size_t need = rbr_sizeof (n);
+
+  if (need > r->cap || n >= RBR_WRAP)
+    return NULL;
+  for (;;)
+    {
+      /* the head might be on a wrap mark, after evicting records */
+      if (r->count)
+        __rbr_fix_head (r);
+      if (0 == r->count || r->tail > r->head)
+        {
+          /* free space: [tail, cap) and [0, head) */
+          if (r->cap - r->tail >= need)
+            {
+              r->__wpos = r->tail;
+              break;
+            }
+          if (0 == r->count || r->head >= need)
+            {
+              r->__wpos = 0;
+              break;
+            }
+        }
+      else if (r->head - r->tail >= need)
+        {
+          /* free space: [tail, head) */
+          r->__wpos = r->tail;
+          break;
+        }
+      __rbr_evict (r);
+    }
+
+  r->__wlen = n;
+  return r->mem + r->__wpos + RBR_HDR;
+}
+
+RINGDEF void
+rbr_commit (RBRecord *r, size_t n)
+{
+  n = MIN (n, r->__wlen);
+  if (r->__wpos != r->tail && r->tail + RBR_HDR <= r->cap)
+    __rbr_len (r, r->tail) = RBR_WRAP;
+
+  __rbr_len (r, r->__wpos) = n;
+  r->tail = r->__wpos + rbr_sizeof (n);
+  r->count++;
+  r->__wlen = 0;
+}
+
+RINGDEF bool
+rbr_write (RBRecord *r, const char *src, size_t n)
+{
+  char *p = rbr_reserve (r, n);
+  if (NULL == p)
+    return false;
+  memcpy (p, src, n);
+  rbr_commit (r, n);
+  return true;
+}
+
+RINGDEF size_t
+rbr_peekn (RBRecord *r, RBSlice out[], size_t n)
+{
+  size_t off = r->head, i;
+
+  n = MIN (n, r->count);
+  for (i = 0; i < n; ++i)
+    {
+      if (off + RBR_HDR > r->cap || RBR_WRAP == __rbr_len (r, off))
+        off = 0;
+      out[i].len = __rbr_len (r, off);
+      out[i].data = r->mem + off + RBR_HDR;
+      off += rbr_sizeof (out[i].len);
+    }
+  return n;
+}
+
+RINGDEF void
+rbr_dropn (RBRecord *r, size_t n)
+{
+  for (n = MIN (n, r->count); n > 0; --n)
+    __rbr_evict (r);
+}
+
 #ifdef HAVE_FILEIO
 RINGDEF void
 rb_fwrite (RBuffer *r, FILE *f, size_t len)
@@ -211,6 +663,20 @@ rb_fwrite (RBuffer *r, FILE *f, size_t len)
   size_t __rest;
   size_t freads;
 
+#ifdef RB_MIRROR
+  if (r->mirror)
+    {
+      if (len > r->cap)
+        {
+          fseek (f, len - r->cap, SEEK_CUR);
+          len = r->cap;
+        }
+      freads = fread (r->mem + r->idx, 1, len, f);
+      __rb_advance (r, freads);
+      return;
+    }
+#endif
+
   if (len < r->cap)
     {
       __rest = MIN (len, r->cap - r->idx);
@@ -258,6 +724,348 @@ rb_fwrite (RBuffer *r, FILE *f, size_t len)
 }
 #endif /* HAVE_FILEIO */
 
+#ifdef HAVE_FDIO
+#include <unistd.h>
+#include <sys/uio.h>
+
+/**
+ *  internal, fills @iov with the spans of the ring's data
+ *  (or the free space when @data is false), up to @n bytes
+ *  @return: number of iovecs
+ */
+static inline int
+__rb_iov (RBuffer *r, struct iovec iov[2], size_t n, bool data)
+{
+  size_t start, len;
+
+  if (data)
+    {
+      start = r->head;
+      len = MIN (n, rb_datalen (r));
+    }
+  else
+    {
+      start = r->idx;
+      len = MIN (n, r->cap);
+    }
+  if (0 == len)
+    return 0;
+
+  iov[0].iov_base = r->mem + start;
+  iov[0].iov_len = len;
+#ifdef RB_MIRROR
+  if (r->mirror)
+    return 1;
+#endif
+  if (start + len <= r->cap)
+    return 1;
+
+  iov[0].iov_len = r->cap - start;
+  iov[1].iov_base = r->mem;
+  iov[1].iov_len = len - iov[0].iov_len;
+  return 2;
+}
+
+/**
+ *  internal, skips @n bytes of @iov of length @cnt
+ *  @return: the new number of iovecs
+ */
+static inline int
+__rb_iov_skip (struct iovec iov[2], int cnt, size_t n)
+{
+  for (int i = 0; i < cnt && n > 0; ++i)
+    {
+      size_t k = MIN (n, iov[i].iov_len);
+      iov[i].iov_base = (char *)iov[i].iov_base + k;
+      iov[i].iov_len -= k;
+      n -= k;
+    }
+  if (cnt > 0 && 0 == iov[0].iov_len)
+    {
+      iov[0] = iov[1];
+      cnt--;
+    }
+  return cnt;
+}
+
+RINGDEF ssize_t
+rb_read_fd (RBuffer *r, int fd, size_t len)
+{
+  struct iovec iov[2];
+  ssize_t n, total = 0;
+  int cnt;
+
+  /* at most cap bytes at a time, the rest overwrites them */
+  while (0 != len && 0 != (cnt = __rb_iov (r, iov, len, false)))
+    {
+      if ((n = readv (fd, iov, cnt)) < 0)
+        return (total) ? total : -1;
+      if (0 == n)
+        break;
+      __rb_advance (r, n);
+      total += n;
+      len -= n;
+    }
+  return total;
+}
+
+RINGDEF ssize_t
+rb_write_fd (RBuffer *r, int fd, size_t n)
+{
+  struct iovec iov[2];
+  ssize_t w, total = 0;
+  int cnt = __rb_iov (r, iov, n, true);
+
+  while (cnt > 0)
+    {
+      if ((w = writev (fd, iov, cnt)) <= 0)
+        return (total) ? total : -1;
+      total += w;
+      /* partial write, skip the written bytes */
+      cnt = __rb_iov_skip (iov, cnt, w);
+    }
+  return total;
+}
+#endif /* HAVE_FDIO */
+
+#ifdef RB_SPLICE
+#include <fcntl.h>
+
+RINGDEF ssize_t
+rb_splice_fd (RBuffer *r, int fd, size_t n, int pipefd[2])
+{
+  struct iovec iov[2];
+  ssize_t v, s, total = 0;
+  int cnt = __rb_iov (r, iov, n, true);
+
+  while (cnt > 0)
+    {
+      /* might take a part of iov, as much as the pipe can hold */
+      if ((v = vmsplice (pipefd[1], iov, cnt, 0)) <= 0)
+        return (total) ? total : -1;
+      for (ssize_t left = v; left > 0; left -= s)
+        {
+          if ((s = splice (pipefd[0], NULL, fd, NULL, left,
+                           SPLICE_F_MOVE)) <= 0)
+            {
+              /* the pipe is not empty anymore */
+              total += v - left;
+              return (total) ? total : -1;
+            }
+        }
+      total += v;
+      cnt = __rb_iov_skip (iov, cnt, v);
+    }
+  return total;
+}
+#endif /* RB_SPLICE */
+
+#ifdef RB_CONCURRENT
+RINGDEF size_t
+rb_spsc_write (RBSpsc *r, const char *src, size_t len)
+{
+  size_t tail = atomic_load_explicit (&r->tail, memory_order_relaxed);
+  size_t __rest, idx;
+
+  if (r->cap - (tail - r->__head_cache) < len)
+    r->__head_cache = atomic_load_explicit (&r->head,
+                                            memory_order_acquire);
+  len = MIN (len, r->cap - (tail - r->__head_cache));
+  if (0 == len)
+    return 0;
+
+  idx = tail & (r->cap - 1);
+  __rest = MIN (len, r->cap - idx);
+  memcpy (r->mem + idx, src, __rest);
+  memcpy (r->mem, src + __rest, len - __rest);
+
+  /* publish the data */
+  atomic_store_explicit (&r->tail, tail + len, memory_order_release);
+  return len;
+}
+
+RINGDEF size_t
+rb_spsc_read (RBSpsc *r, char *dest, size_t len)
+{
+  size_t head = atomic_load_explicit (&r->head, memory_order_relaxed);
+  size_t __rest, idx;
+
+  if (r->__tail_cache - head < len)
+    r->__tail_cache = atomic_load_explicit (&r->tail,
+                                            memory_order_acquire);
+  len = MIN (len, r->__tail_cache - head);
+  if (0 == len)
+    return 0;
+
+  idx = head & (r->cap - 1);
+  __rest = MIN (len, r->cap - idx);
+  memcpy (dest, r->mem + idx, __rest);
+  memcpy (dest + __rest, r->mem, len - __rest);
+
+  /* release the space to the producer */
+  atomic_store_explicit (&r->head, head + len, memory_order_release);
+  return len;
+}
+
+RINGDEF void
+rb_spsc_write_wait (RBSpsc *r, const char *src, size_t len)
+{
+  size_t n;
+  while (0 != len)
+    {
+      if (0 == (n = rb_spsc_write (r, src, len)))
+        rb_relax ();
+      src += n;
+      len -= n;
+    }
+}
+
+RINGDEF void
+rb_spsc_read_wait (RBSpsc *r, char *dest, size_t len)
+{
+  size_t n;
+  while (0 != len)
+    {
+      if (0 == (n = rb_spsc_read (r, dest, len)))
+        rb_relax ();
+      dest += n;
+      len -= n;
+    }
+}
+
+/* internal, sequence number and data of the cell at @pos */
+#define __rb_mpmc_seq(q, pos)                                   \
+  ((_Atomic size_t *)((q)->mem + ((pos) & ((q)->cap - 1))       \
+                      * __rb_mpmc_stride ((q)->cell)))
+#define __rb_mpmc_data(q, pos) ((char *)(__rb_mpmc_seq (q, pos) + 1))
+
+RINGDEF void
+rb_mpmc_init (RBMpmc *q)
+{
+  for (size_t i = 0; i < q->cap; ++i)
+    atomic_init (__rb_mpmc_seq (q, i), i);
+  atomic_init (&q->head, 0);
+  atomic_init (&q->tail, 0);
+}
+
+RINGDEF size_t
+rb_mpmc_pushn (RBMpmc *q, const void *cells, size_t n)
+{
+  size_t pos, k;
+  n = MIN (n, q->cap);
+  if (0 == n)
+    return 0;
+
+  pos = atomic_load_explicit (&q->tail, memory_order_relaxed);
+  for (;;)
+    {
+      /* count cells ready to write, starting from @pos */
+      for (k = 0; k < n; ++k)
+        {
+          size_t seq = atomic_load_explicit (__rb_mpmc_seq (q, pos + k),
+                                             memory_order_acquire);
+          if (seq != pos + k)
+            break;
+        }
+      if (0 == k)
+        {
+          size_t seq = atomic_load_explicit (__rb_mpmc_seq (q, pos),
+                                             memory_order_acquire);
+          if ((ssize_t)(seq - pos) < 0)
+            return 0; /* full */
+          /* other producers took it */
+          pos = atomic_load_explicit (&q->tail, memory_order_relaxed);
+          continue;
+        }
+      if (atomic_compare_exchange_weak_explicit (&q->tail, &pos, pos + k,
+                                                 memory_order_relaxed,
+                                                 memory_order_relaxed))
+        break;
+    }
+
+  for (size_t i = 0; i < k; ++i)
+    {
+      memcpy (__rb_mpmc_data (q, pos + i),
+              (const char *)cells + i * q->cell, q->cell);
+      atomic_store_explicit (__rb_mpmc_seq (q, pos + i), pos + i + 1,
+                             memory_order_release);
+    }
+  return k;
+}
+
+RINGDEF size_t
+rb_mpmc_popn (RBMpmc *q, void *cells, size_t n)
+{
+  size_t pos, k;
+  n = MIN (n, q->cap);
+  if (0 == n)
+    return 0;
+
+  pos = atomic_load_explicit (&q->head, memory_order_relaxed);
+  for (;;)
+    {
+      /* count cells ready to read, starting from @pos */
+      for (k = 0; k < n; ++k)
+        {
+          size_t seq = atomic_load_explicit (__rb_mpmc_seq (q, pos + k),
+                                             memory_order_acquire);
+          if (seq != pos + k + 1)
+            break;
+        }
+      if (0 == k)
+        {
+          size_t seq = atomic_load_explicit (__rb_mpmc_seq (q, pos),
+                                             memory_order_acquire);
+          if ((ssize_t)(seq - (pos + 1)) < 0)
+            return 0; /* empty */
+          /* other consumers took it */
+          pos = atomic_load_explicit (&q->head, memory_order_relaxed);
+          continue;
+        }
+      if (atomic_compare_exchange_weak_explicit (&q->head, &pos, pos + k,
+                                                 memory_order_relaxed,
+                                                 memory_order_relaxed))
+        break;
+    }
+
+  for (size_t i = 0; i < k; ++i)
+    {
+      memcpy ((char *)cells + i * q->cell,
+              __rb_mpmc_data (q, pos + i), q->cell);
+      /* ready for the producers of the next round */
+      atomic_store_explicit (__rb_mpmc_seq (q, pos + i), pos + i + q->cap,
+                             memory_order_release);
+    }
+  return k;
+}
+
+RINGDEF bool
+rb_mpmc_push (RBMpmc *q, const void *cell)
+{
+  return 1 == rb_mpmc_pushn (q, cell, 1);
+}
+
+RINGDEF bool
+rb_mpmc_pop (RBMpmc *q, void *cell)
+{
+  return 1 == rb_mpmc_popn (q, cell, 1);
+}
+
+RINGDEF void
+rb_mpmc_push_wait (RBMpmc *q, const void *cell)
+{
+  while (!rb_mpmc_push (q, cell))
+    rb_relax ();
+}
+
+RINGDEF void
+rb_mpmc_pop_wait (RBMpmc *q, void *cell)
+{
+  while (!rb_mpmc_pop (q, cell))
+    rb_relax ();
+}
+#endif /* RB_CONCURRENT */
+
 #endif /* RB_IMPLEMENTATION */
 
 
@@ -296,7 +1104,8 @@ map_file2ring (FILE *f, RBuffer *r)
   if (NULL == f || 0 > ffd)
     return 1;
 
-  ftruncate (ffd, r->cap);
+  if (0 != ftruncate (ffd, r->cap))
+    return 1;
 
   if (MAP_FAILED == (r->mem = mmap (
        NULL, r->cap,
@@ -412,7 +1221,8 @@ TEST_3 (RBuffer *r)
 {
   rbassert (r->mem != NULL, "NULL", true);
   FILE *tmp_file = tmpfile ();
-  ftruncate (fileno (tmp_file), 50);
+  if (0 != ftruncate (fileno (tmp_file), 50))
+    RETFAIL (1);
   fwrite ("ABCDEFGHIJ012345678901234567890123456789abcdefghij",
           1, 50, tmp_file);
   fseek (tmp_file, 0, SEEK_SET);
@@ -467,6 +1277,337 @@ TEST_3 (RBuffer *r)
   RETPASS ();
 }
 
+#ifdef RB_CONCURRENT
+#include <pthread.h>
+
+#define CTEST_BYTES (1024 * 1024)
+#define CTEST_THREADS 4
+#define CTEST_CELLS 100000
+
+void *
+__spsc_producer (void *arg)
+{
+  RBSpsc *r = arg;
+  char buf[97]; /* not a divisor of the capacity */
+  size_t n = 0;
+
+  while (n < CTEST_BYTES)
+    {
+      size_t len = MIN (sizeof (buf), CTEST_BYTES - n);
+      for (size_t i = 0; i < len; ++i)
+        buf[i] = (char)((n + i) * 7);
+      rb_spsc_write_wait (r, buf, len);
+      n += len;
+    }
+  return NULL;
+}
+
+int
+TEST_4 (RBSpsc *r)
+{
+  pthread_t th;
+  char buf[61];
+  size_t n = 0;
+
+  pthread_create (&th, NULL, __spsc_producer, r);
+  while (n < CTEST_BYTES)
+    {
+      size_t len = rb_spsc_read (r, buf, MIN (sizeof (buf),
+                                              CTEST_BYTES - n));
+      if (0 == len)
+        rb_relax ();
+      for (size_t i = 0; i < len; ++i, ++n)
+        if (buf[i] != (char)(n * 7))
+          {
+            fprintf (stderr, "byte %lu is corrupted\n", n);
+            RETFAIL (1);
+          }
+    }
+  pthread_join (th, NULL);
+  rbassert (0 == rb_spsc_size (r), "spsc size", false);
+  rbassert (0 == rb_spsc_read (r, buf, 1), "spsc empty", false);
+
+  RETPASS ();
+}
+
+struct mpmc_arg_t {
+  RBMpmc *q;
+  size_t id;
+  size_t sum;
+};
+
+void *
+__mpmc_producer (void *arg)
+{
+  struct mpmc_arg_t *a = arg;
+  size_t batch[8];
+
+  for (size_t i = 0; i < CTEST_CELLS; )
+    {
+      if (i % 3)
+        {
+          size_t v = a->id * CTEST_CELLS + i++;
+          rb_mpmc_push_wait (a->q, &v);
+        }
+      else
+        {
+          size_t n = MIN (8, CTEST_CELLS - i);
+          for (size_t j = 0; j < n; ++j)
+            batch[j] = a->id * CTEST_CELLS + i + j;
+          if (0 == (n = rb_mpmc_pushn (a->q, batch, n)))
+            rb_relax ();
+          i += n;
+        }
+    }
+  return NULL;
+}
+
+void *
+__mpmc_consumer (void *arg)
+{
+  struct mpmc_arg_t *a = arg;
+  size_t batch[8], n;
+
+  for (size_t i = 0; i < CTEST_CELLS; )
+    {
+      if (i % 2)
+        {
+          rb_mpmc_pop_wait (a->q, batch);
+          a->sum += batch[0];
+          i++;
+        }
+      else
+        {
+          if (0 == (n = rb_mpmc_popn (a->q, batch,
+                                      MIN (8, CTEST_CELLS - i))))
+            rb_relax ();
+          for (size_t j = 0; j < n; ++j)
+            a->sum += batch[j];
+          i += n;
+        }
+    }
+  return NULL;
+}
+
+int
+TEST_5 (RBMpmc *q)
+{
+  pthread_t pth[CTEST_THREADS], cth[CTEST_THREADS];
+  struct mpmc_arg_t pargs[CTEST_THREADS], cargs[CTEST_THREADS];
+  size_t sum = 0, all = CTEST_THREADS * CTEST_CELLS, tmp;
+
+  for (size_t i = 0; i < CTEST_THREADS; ++i)
+    {
+      pargs[i] = (struct mpmc_arg_t){.q = q, .id = i};
+      cargs[i] = (struct mpmc_arg_t){.q = q, .id = i};
+      pthread_create (pth + i, NULL, __mpmc_producer, pargs + i);
+      pthread_create (cth + i, NULL, __mpmc_consumer, cargs + i);
+    }
+  for (size_t i = 0; i < CTEST_THREADS; ++i)
+    {
+      pthread_join (pth[i], NULL);
+      pthread_join (cth[i], NULL);
+      sum += cargs[i].sum;
+    }
+
+  /* every value, exactly once */
+  rbassert (sum == all * (all - 1) / 2, "mpmc sum", false);
+  rbassert (!rb_mpmc_pop (q, &tmp), "mpmc empty", false);
+  if (sum != all * (all - 1) / 2)
+    RETFAIL (1);
+
+  /* empty batches, on a ring that is neither full nor empty */
+  tmp = 42;
+  rb_mpmc_push (q, &tmp);
+  if (0 != rb_mpmc_pushn (q, &tmp, 0) || 0 != rb_mpmc_popn (q, &tmp, 0))
+    RETFAIL (2);
+  if (!rb_mpmc_pop (q, &tmp) || tmp != 42)
+    RETFAIL (3);
+
+  RETPASS ();
+}
+#endif /* RB_CONCURRENT */
+
+#ifdef RB_MIRROR
+int
+TEST_6 (RBuffer *m)
+{
+  size_t cap = m->cap;
+  RBuffer r = rb_new (malloc (cap), cap);
+  char *src = malloc (3 * cap), *d1 = malloc (cap), *d2 = malloc (cap);
+  const size_t lens[] = {7, 100, cap - 3, 1, cap, 2 * cap + 5, 13, 0};
+  int ret = 0;
+
+  for (size_t i = 0; i < 3 * cap; ++i)
+    src[i] = 'a' + i % 26;
+
+  /* must behave the same as the normal ring */
+  for (size_t i = 0, off = 0; i < sizeof (lens) / sizeof (*lens); ++i)
+    {
+      rb_writen (m, src + off % cap, lens[i]);
+      rb_writen (&r, src + off % cap, lens[i]);
+      off += lens[i];
+
+      rb_readn (m, cap, d1);
+      rb_readn (&r, cap, d2);
+      rbassert (rb_datalen (m) == rb_datalen (&r), "data length", false);
+      rbassert (0 == memcmp (d1, d2, rb_datalen (m)), "readn", false);
+      /* contiguous, in place */
+      rbassert (0 == memcmp (rb_data (m), d2, rb_datalen (m)),
+                "in place", false);
+      ret |= (rb_datalen (m) != rb_datalen (&r) ||
+              0 != memcmp (rb_data (m), d2, rb_datalen (m)));
+    }
+  rbassert (m->mem[0] == m->mem[cap], "mirror", false);
+  ret |= (m->mem[0] != m->mem[cap]);
+
+  free (r.mem);
+  free (src);
+  free (d1);
+  free (d2);
+  if (ret)
+    RETFAIL (1);
+  RETPASS ();
+}
+#endif /* RB_MIRROR */
+
+#ifdef HAVE_FDIO
+int
+TEST_7 (RBuffer *r)
+{
+  const char *input = "ABCDEFGHIJ0123456789012345678901234567890abcdefghij";
+  size_t len = strlen (input);
+  RBuffer ref = rb_new (malloc (r->cap), r->cap);
+  char *d1 = malloc (r->cap + 1), *d2 = malloc (r->cap + 1);
+  int fds[2], ret = 0;
+
+  if (0 != pipe (fds))
+    RETFAIL (1);
+  rb_reset (r);
+
+  /* fd to ring, the same as rb_writen */
+  for (size_t off = 0, n = 7; off < len; off += n, n += 11)
+    {
+      n = MIN (n, len - off);
+      ret |= ((ssize_t)n != write (fds[1], input + off, n));
+      ret |= ((ssize_t)n != rb_read_fd (r, fds[0], n));
+      rb_writen (&ref, input + off, n);
+
+      rb_readn (r, r->cap, d1);
+      rb_readn (&ref, ref.cap, d2);
+      rbassert (rb_datalen (r) == rb_datalen (&ref)
+                && 0 == memcmp (d1, d2, rb_datalen (r)),
+                "rb_read_fd", false);
+      ret |= (rb_datalen (r) != rb_datalen (&ref)
+              || 0 != memcmp (d1, d2, rb_datalen (r)));
+    }
+
+  /* ring to fd */
+  memset (d2, 0, r->cap + 1);
+  ret |= ((ssize_t)r->cap != rb_write_fd (r, fds[1], r->cap));
+  ret |= ((ssize_t)r->cap != read (fds[0], d2, r->cap));
+  strnassert (d1, d2, r->cap, "rb_write_fd", false);
+  ret |= (0 != strncmp (d1, d2, r->cap));
+
+#ifdef RB_SPLICE
+  int pfds[2];
+  if (0 != pipe (pfds))
+    RETFAIL (1);
+  memset (d2, 0, r->cap + 1);
+  ret |= ((ssize_t)r->cap != rb_splice_fd (r, fds[1], r->cap, pfds));
+  ret |= ((ssize_t)r->cap != read (fds[0], d2, r->cap));
+  strnassert (d1, d2, r->cap, "rb_splice_fd", false);
+  ret |= (0 != strncmp (d1, d2, r->cap));
+  close (pfds[0]);
+  close (pfds[1]);
+#endif
+
+  close (fds[0]);
+  close (fds[1]);
+  free (ref.mem);
+  free (d1);
+  free (d2);
+  if (ret)
+    RETFAIL (1);
+  RETPASS ();
+}
+#endif /* HAVE_FDIO */
+
+int
+TEST_8 (RBRecord *r)
+{
+  RBSlice out[16];
+  char rec[40];
+  size_t n, last = 0;
+  int ret = 0;
+
+  rbassert (NULL == rbr_reserve (r, r->cap), "too large record", false);
+  ret |= (NULL != rbr_reserve (r, r->cap));
+
+  /* records of length 1, ..., 19: `r<i>:xxx...` */
+  for (size_t i = 0; i < 40; ++i)
+    {
+      size_t len = 1 + (i * 7) % 19;
+      if (i % 2)
+        {
+          memset (rec, 'a' + i % 26, len);
+          rec[0] = '0' + i % 10;
+          rbassert (rbr_write (r, rec, len), "rbr_write", false);
+        }
+      else
+        {
+          /* reserve more, commit less */
+          char *p = rbr_reserve (r, len + 4);
+          memset (p, 'a' + i % 26, len);
+          p[0] = '0' + i % 10;
+          rbr_commit (r, len);
+        }
+
+      /* must be the last records, as a whole */
+      n = rbr_peekn (r, out, 16);
+      ret |= (n == 0);
+      for (size_t j = 0; j < n; ++j)
+        {
+          size_t k = i - (n - 1 - j);
+          size_t klen = 1 + (k * 7) % 19;
+          ret |= (out[j].len != klen);
+          ret |= (out[j].data[0] != (char)('0' + k % 10));
+          ret |= (out[j].data[klen - 1] !=
+                  (char)((klen == 1) ? '0' + k % 10 : 'a' + k % 26));
+        }
+      last = out[n - 1].len;
+    }
+  rbassert (0 == ret, "last records", false);
+  ret |= (last != 1 + (39 * 7) % 19);
+
+  /* batched consume */
+  n = r->count;
+  rbr_dropn (r, n - 1);
+  ret |= (1 != rbr_peekn (r, out, 16) || out[0].len != last);
+  rbr_dropn (r, 16);
+  ret |= (0 != r->count || 0 != rbr_peekn (r, out, 16));
+
+  /**
+   *  the head on the wrap mark (at 56), and 40 bytes free
+   *  at [24, 64), the last record must not be evicted
+   */
+  rbr_reset (r);
+  memset (rec, 'x', sizeof (rec));
+  rbr_write (r, rec, 20);
+  rbr_write (r, rec, 4);
+  rbr_write (r, rec, 20);
+  rbr_write (r, rec, 20);
+  rbr_dropn (r, 2);
+  rbr_write (r, rec, 36);
+  n = rbr_peekn (r, out, 16);
+  rbassert (2 == n, "evict only on overflow", false);
+  ret |= (2 != n || 20 != out[0].len || 36 != out[1].len);
+
+  if (ret)
+    RETFAIL (1);
+  RETPASS ();
+}
+
 int
 main (void)
 {
@@ -485,6 +1626,33 @@ main (void)
   TESTFUN (TEST_1, &ring);
   TESTFUN (TEST_2, &ring);
   TESTFUN (TEST_3, &ring);
+
+#ifdef RB_CONCURRENT
+  RBSpsc spsc = rb_spsc_new (malloc (64), 64);
+  TESTFUN (TEST_4, &spsc);
+  free (spsc.mem);
+
+  RBMpmc mpmc = rb_mpmc_new (NULL, 64, sizeof (size_t));
+  mpmc.mem = malloc (rb_mpmc_sizeof (mpmc.cap, mpmc.cell));
+  rb_mpmc_init (&mpmc);
+  TESTFUN (TEST_5, &mpmc);
+  free (mpmc.mem);
+#endif
+
+#ifdef RB_MIRROR
+  RBuffer mirror;
+  rbassert (0 == rb_mirror_map (&mirror, 1), "mirror map", true);
+  TESTFUN (TEST_6, &mirror);
+  rbassert (0 == rb_mirror_unmap (&mirror), "mirror unmap", true);
+#endif
+
+#ifdef HAVE_FDIO
+  TESTFUN (TEST_7, &ring);
+#endif
+
+  uint32_t rmem[16]; /* 64B, aligned */
+  RBRecord records = rbr_new ((char *)rmem, sizeof (rmem));
+  TESTFUN (TEST_8, &records);
   
   rbassert (0 == munmap (ring.mem, ring.cap),
              "munmap failed, broken ring logic!", true);
@@ -17,6 +17,9 @@
            -D TAPE_MEM_TEST \
            -o test.out tape_mem.c
   
+      to test the file-backed tape and fd ingestion, also pass:
+           -D_GNU_SOURCE -D TAPE_FILE -D TAPE_FDIO
+  
       to include in other files:
       ```c
       #include <stlib.h>
@@ -48,12 +51,70 @@
         return 0;
       }
       ```
+  
+    Indexed access:
+      tape_get walks the tape from the beginning, to make it
+      faster, attach a TapeIndex to the tape (before appending)
+      it keeps the offset of every `stride`-th record, in a user
+      provided buffer; when the buffer is full, every other entry
+      is dropped and the stride gets doubled, so tape_get
+      walks at most `stride` records
+      ```c
+        size_t offsets[1024];
+        TapeIndex index = new_tape_index (offsets, 1024, 1);
+        mem.index = &index;
+      ```
+      with a fixed buffer of `cap` entries, the stride ends up
+      around count/cap, so tape_get is O(1) only while the tape
+      has at most cap * stride records, and O(n/cap) after that
+      to keep it O(1), set `index.grow` (e.g. to realloc), then
+      the buffer (allocated by the same allocator) is grown
+      instead, and the stride never changes
+      ```c
+        TapeIndex index = new_tape_index (malloc (1024 * sizeof (size_t)),
+                                          1024, 1);
+        index.grow = realloc;
+      ```
+      to index an already filled tape, use `tape_index_build`
+  
+    Batch append:
+      `tape_append_batch` appends an array of DBuffers, with a
+      single capacity check (and growth) for the whole batch
+      with `TAPE_FDIO`, `tape_readv` reads records of the given
+      lengths from a file descriptor, directly into the tape
+      using readv (no intermediate buffer)
+  
+    File-backed tape:
+      when compiled with `TAPE_FILE` (linux only, needs _GNU_SOURCE)
+      the tape can live in a memory mapped file, which grows by
+      doubling on overflow (ftruncate + mremap), and has a header
+      so it can be reopened after restart; the length in the header
+      is updated after each append, so a crashed process leaves a
+      consistent tape behind, use `tape_sync` for durability
+      growing might move the mapping, like reallocation, it makes
+      your pointers invalid (offsets and indices stay valid)
+      ```c
+        Tape log = new_tape (4096);
+        if (0 != tape_open (&log, "records.tape"))
+          exit (1);
+        tape_append (&log, &tmp);
+        tape_close (&log);
+      ```
+  
+    Cursor:
+      for sequential scans, use `tape_next`
+      ```c
+        TapeCursor cur = tape_cursor (&mem);
+        for (char *d; (d = tape_next (&cur)); )
+          puts (d);
+      ```
  **/
 #ifndef TAPE_MEM__H__
 #define TAPE_MEM__H__
 #include <assert.h>
 #include <stddef.h>
 #include <string.h>
+#include <stdbool.h>
 
 #define BUF_MAX_LEN (256*1024)
 struct buff_t {
@@ -71,13 +132,56 @@ typedef struct buff_t DBuffer; /* data buffer */
 #define bufferof(data_ptr) \
   (DBuffer*)(data_ptr - offsetof (DBuffer, data))
 
+struct tape_index_t {
+  size_t *offs; /* offs[i]: offset of the record i*stride */
+  size_t len, cap; /* of offs */
+  size_t stride; /* must be a power of 2 */
+  size_t count; /* number of records in the tape */
+  /**
+   *  optional, to grow @offs instead of doubling the stride
+   *  like realloc, NULL on failure
+   */
+  void *(*grow) (void *offs, size_t size);
+};
+typedef struct tape_index_t TapeIndex;
+#define new_tape_index(buf, capacity, strd)                         \
+  (TapeIndex){.offs=buf, .len=0, .cap=capacity, .stride=strd,       \
+      .count=0, .grow=NULL}
+
 struct tape_t {
   size_t len, cap;
   char *data; /* array of buff_t structs */
+  TapeIndex *index; /* optional, NULL to disable */
+#ifdef TAPE_FILE
+  int fd; /* file-backed tape, -1 otherwise */
+#endif
 };
 typedef struct tape_t Tape;
-#define new_tape(capacity)                      \
-  (Tape){.len=0, .cap=capacity, .data=NULL,}
+#ifdef TAPE_FILE
+# define new_tape(capacity)                                          \
+  (Tape){.len=0, .cap=capacity, .data=NULL, .index=NULL, .fd=-1}
+#else
+# define new_tape(capacity)                                  \
+  (Tape){.len=0, .cap=capacity, .data=NULL, .index=NULL}
+#endif
+
+#ifdef TAPE_FILE
+#define TAPE_MAGIC "TAPEMEM1"
+/* header of file-backed tapes, right before tape->data */
+struct tape_fheader_t {
+  char magic[8];
+  size_t len; /* committed length of the tape */
+};
+#define tape_fheaderof(tape) \
+  ((struct tape_fheader_t *)((tape)->data - sizeof (struct tape_fheader_t)))
+#endif
+
+struct tape_cursor_t {
+  const Tape *tape;
+  size_t off; /* offset of the next record */
+};
+typedef struct tape_cursor_t TapeCursor;
+#define tape_cursor(tape_ptr) (TapeCursor){.tape=tape_ptr, .off=0}
 
 #ifndef TAPEMEMDEF
 #  define TAPEMEMDEF static inline
@@ -99,10 +203,148 @@ TAPEMEMDEF char *tape_append (Tape *tape, const DBuffer *buf);
  */
 TAPEMEMDEF char *tape_get (const Tape *tape, size_t index);
 
+/**
+ *  append @n DBuffers to a tape
+ *  stops at the first buffer that is empty, too large
+ *  or does not fit in the tape
+ *  @return:  number of appended buffers
+ */
+TAPEMEMDEF size_t tape_append_batch (Tape *tape, const DBuffer *bufs,
+                                     size_t n);
+
+#ifdef TAPE_FDIO
+#include <sys/types.h>
+/**
+ *  read @n records of length @lens[i] from @fd into the tape
+ *  the bytes of an incomplete record (at EOF) are dropped
+ *  @return:  number of appended records, -1 on read error
+ *            (records read before the error are kept)
+ */
+TAPEMEMDEF ssize_t tape_readv (Tape *tape, int fd,
+                               const size_t *lens, size_t n);
+#endif
+
+/**
+ *  (re)builds the index of @tape, by scanning it
+ *  @tape->index must be set
+ */
+TAPEMEMDEF void tape_index_build (Tape *tape);
+
+/**
+ *  cursor API
+ *  @return: NULL at the end of the tape,
+ *           pointer to the next DBuffer otherwise
+ */
+TAPEMEMDEF char *tape_next (TapeCursor *cur);
+/**
+ *  moves @cur to the DBuffer at @index (starts from 1)
+ *  @return: false when @index is out of range
+ */
+TAPEMEMDEF bool tape_seek (TapeCursor *cur, size_t index);
+
+#ifdef TAPE_FILE
+/**
+ *  opens (or creates) the file-backed tape at @path
+ *  @tape->cap is the initial capacity of new files
+ *  for existing files, broken records at the end are
+ *  ignored, and tape->index (if any) is rebuilt
+ *  only empty files are initialized, other non-tape files
+ *  fail with EINVAL
+ *  @return: 0 on success, -1 on failure (errno is set)
+ */
+TAPEMEMDEF int tape_open (Tape *tape, const char *path);
+/* flushes the tape to the disk, @return: 0 on success */
+TAPEMEMDEF int tape_sync (Tape *tape);
+/* unmaps and closes the tape, the file remains */
+TAPEMEMDEF void tape_close (Tape *tape);
+#endif /* TAPE_FILE */
+
 #endif /* TAPE_MEM__H__ */
 
 
 #ifdef TAPE_MEM_IMPLEMENTATION
+#ifdef TAPE_FDIO
+#include <sys/uio.h>
+/* number of records per readv call */
+#ifndef TAPE_IOV_BATCH
+# define TAPE_IOV_BATCH 64
+#endif
+#endif /* TAPE_FDIO */
+
+#ifdef TAPE_FILE
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define __TAPE_FHDR sizeof (struct tape_fheader_t)
+
+/* internal, grows file-backed @tape to hold @need bytes */
+static inline int
+__tape_grow (Tape *tape, size_t need)
+{
+  size_t cap = tape->cap;
+  char *base = tape->data - __TAPE_FHDR;
+
+  while (cap <= need)
+    cap *= 2;
+  if (0 != ftruncate (tape->fd, __TAPE_FHDR + cap))
+    return -1;
+  base = mremap (base, __TAPE_FHDR + tape->cap,
+                 __TAPE_FHDR + cap, MREMAP_MAYMOVE);
+  if (MAP_FAILED == base)
+    return -1;
+  tape->data = base + __TAPE_FHDR;
+  tape->cap = cap;
+  return 0;
+}
+#endif /* TAPE_FILE */
+
+/**
+ *  internal, the data length of the record at @p
+ *  records are not aligned, so their headers are copied
+ */
+static inline size_t
+__tape_reclen (const char *p)
+{
+  size_t len;
+  memcpy (&len, p, sizeof (len));
+  return len;
+}
+
+/* internal, keeps the offset @off of a new record in @idx */
+static inline void
+__tape_index_add (TapeIndex *idx, size_t off)
+{
+  if (0 == idx->cap)
+    return;
+  if (0 == idx->count % idx->stride)
+    {
+      if (idx->len == idx->cap && idx->grow)
+        {
+          size_t *offs = idx->grow (idx->offs,
+                                    2 * idx->cap * sizeof (size_t));
+          if (offs)
+            {
+              idx->offs = offs;
+              idx->cap *= 2;
+            }
+        }
+      if (idx->len == idx->cap)
+        {
+          /* drop every other entry */
+          for (size_t i = 1; 2*i < idx->len; ++i)
+            idx->offs[i] = idx->offs[2*i];
+          idx->len = (idx->len + 1) / 2;
+          idx->stride *= 2;
+        }
+      if (0 == idx->count % idx->stride)
+        idx->offs[idx->len++] = off;
+    }
+  idx->count++;
+}
+
 TAPEMEMDEF char *
 tape_append (Tape *tape, const DBuffer *buf)
 {
@@ -112,15 +354,162 @@ tape_append (Tape *tape, const DBuffer *buf)
   size_t __buf_size = sizeof_buffer (buf);
   if (__buf_size > BUF_MAX_LEN)
     return NULL;
+#ifdef TAPE_FILE
+  if (-1 != tape->fd && tape->len + __buf_size >= tape->cap)
+    if (0 != __tape_grow (tape, tape->len + __buf_size))
+      return NULL;
+#endif
   if (tape->len + __buf_size >= tape->cap)
     return NULL;
 
   char *p = memcpy (tape->data + tape->len, buf, offsetof (DBuffer, data));
   memcpy (p + offsetof (DBuffer, data), buf->data, buf->len);
+  if (tape->index)
+    __tape_index_add (tape->index, tape->len);
   tape->len += __buf_size;
+#ifdef TAPE_FILE
+  if (-1 != tape->fd)
+    tape_fheaderof (tape)->len = tape->len;
+#endif
   return p + offsetof (DBuffer, data);
 }
 
+/**
+ *  internal, how many of @n records of lengths @lens[i*stride]
+ *  are valid and fit in the tape, sets @size to their total size
+ *  grows file-backed tapes when needed
+ */
+static inline size_t
+__tape_fit (Tape *tape, const size_t *lens, size_t stride,
+            size_t n, size_t *size)
+{
+  size_t i, total = 0, len;
+
+  for (i = 0; i < n; ++i)
+    {
+      len = *(const size_t *)((const char *)lens + i * stride);
+      if (0 == len || buffer_of_size (len) > BUF_MAX_LEN)
+        break;
+      total += buffer_of_size (len);
+    }
+#ifdef TAPE_FILE
+  if (-1 != tape->fd && tape->len + total >= tape->cap)
+    __tape_grow (tape, tape->len + total);
+#endif
+  while (0 != i && tape->len + total >= tape->cap)
+    {
+      --i;
+      len = *(const size_t *)((const char *)lens + i * stride);
+      total -= buffer_of_size (len);
+    }
+  *size = total;
+  return i;
+}
+
+/* internal, accounts @n records written at the end of the tape */
+static inline void
+__tape_commit (Tape *tape, size_t n, size_t size)
+{
+  if (tape->index)
+    {
+      char *p = tape->data + tape->len;
+      for (; n > 0; --n)
+        {
+          __tape_index_add (tape->index, p - tape->data);
+          p += buffer_of_size (__tape_reclen (p));
+        }
+    }
+  tape->len += size;
+#ifdef TAPE_FILE
+  if (-1 != tape->fd)
+    tape_fheaderof (tape)->len = tape->len;
+#endif
+}
+
+TAPEMEMDEF size_t
+tape_append_batch (Tape *tape, const DBuffer *bufs, size_t n)
+{
+  size_t size;
+
+  if (NULL == tape->data || 0 == tape->cap)
+    return 0;
+
+  n = __tape_fit (tape, &bufs->len, sizeof (DBuffer), n, &size);
+  char *p = tape->data + tape->len;
+  for (size_t i = 0; i < n; ++i)
+    {
+      /* records are not aligned */
+      memcpy (p, &bufs[i].len, sizeof (size_t));
+      memcpy (p + offsetof (DBuffer, data), bufs[i].data, bufs[i].len);
+      p += buffer_of_size (bufs[i].len);
+    }
+  __tape_commit (tape, n, size);
+  return n;
+}
+
+#ifdef TAPE_FDIO
+TAPEMEMDEF ssize_t
+tape_readv (Tape *tape, int fd, const size_t *lens, size_t n)
+{
+  struct iovec iov[TAPE_IOV_BATCH];
+  size_t size, done = 0;
+
+  if (NULL == tape->data || 0 == tape->cap)
+    return 0;
+
+  n = __tape_fit (tape, lens, sizeof (size_t), n, &size);
+  while (done < n)
+    {
+      size_t cnt = (n - done < TAPE_IOV_BATCH) ? n - done : TAPE_IOV_BATCH;
+      size_t want = 0, got = 0, i;
+      char *p = tape->data + tape->len;
+      ssize_t r = 0;
+
+      /* headers first, then read all the data at once */
+      for (i = 0; i < cnt; ++i)
+        {
+          memcpy (p, lens + done + i, sizeof (size_t));
+          iov[i].iov_base = p + offsetof (DBuffer, data);
+          iov[i].iov_len = lens[done + i];
+          want += lens[done + i];
+          p += buffer_of_size (lens[done + i]);
+        }
+
+      struct iovec *v = iov;
+      int vcnt = cnt;
+      while (got < want)
+        {
+          if ((r = readv (fd, v, vcnt)) <= 0)
+            break;
+          got += r;
+          /* skip the filled iovecs */
+          for (; vcnt > 0 && (size_t)r >= v->iov_len; ++v, --vcnt)
+            r -= v->iov_len;
+          if (vcnt > 0)
+            {
+              v->iov_base = (char *)v->iov_base + r;
+              v->iov_len -= r;
+            }
+        }
+
+      /* keep the complete records */
+      for (i = 0, size = 0; i < cnt && got >= lens[done + i]; ++i)
+        {
+          got -= lens[done + i];
+          size += buffer_of_size (lens[done + i]);
+        }
+      __tape_commit (tape, i, size);
+      done += i;
+
+      if (r < 0)
+        return (0 == done) ? -1 : (ssize_t)done;
+      if (i < cnt)
+        break; /* EOF */
+    }
+  return done;
+}
+#endif /* TAPE_FDIO */
+
 TAPEMEMDEF char *
 tape_get (const Tape *tape, size_t index)
 {
@@ -130,12 +519,25 @@ tape_get (const Tape *tape, size_t index)
   if (NULL == tape->data)
     return NULL;
 
-  DBuffer *buf = (DBuffer *)p;
+  if (tape->index && 0 != tape->index->len)
+    {
+      const TapeIndex *idx = tape->index;
+      if (0 == index || index > idx->count)
+        return NULL;
+      index--;
+      p += idx->offs[index / idx->stride];
+      for (index %= idx->stride; 0 != index; --index)
+        p += buffer_of_size (__tape_reclen (p));
+      return p + offsetof (DBuffer, data);
+    }
+
+  char *buf = p;
   while (0 != index && 0 != p_len)
     {
-      buf = (DBuffer *)p;
-      size_t __buf_size = buffer_of_size (buf->len);
-      assert ((__buf_size < BUF_MAX_LEN) && (0 != buf->len) &&
+      buf = p;
+      size_t len = __tape_reclen (buf);
+      size_t __buf_size = buffer_of_size (len);
+      assert ((__buf_size < BUF_MAX_LEN) && (0 != len) &&
               "broken logic or memory corruption");
       p_len -= __buf_size;
       p += __buf_size;
@@ -143,11 +545,148 @@ tape_get (const Tape *tape, size_t index)
     }
 
   if (index == 0)
-    return (char *)buf + offsetof (DBuffer, data);
+    return buf + offsetof (DBuffer, data);
   else
     return NULL;
 }
 
+TAPEMEMDEF void
+tape_index_build (Tape *tape)
+{
+  TapeIndex *idx = tape->index;
+  size_t off = 0;
+
+  idx->len = 0;
+  idx->count = 0;
+  while (off < tape->len)
+    {
+      size_t len = __tape_reclen (tape->data + off);
+      assert ((0 != len) && "broken logic or memory corruption");
+      __tape_index_add (idx, off);
+      off += buffer_of_size (len);
+    }
+}
+
+TAPEMEMDEF char *
+tape_next (TapeCursor *cur)
+{
+  const Tape *tape = cur->tape;
+
+  if (NULL == tape->data || cur->off >= tape->len)
+    return NULL;
+
+  char *p = tape->data + cur->off;
+  cur->off += buffer_of_size (__tape_reclen (p));
+  return p + offsetof (DBuffer, data);
+}
+
+TAPEMEMDEF bool
+tape_seek (TapeCursor *cur, size_t index)
+{
+  char *p = tape_get (cur->tape, index);
+
+  if (NULL == p || 0 == index)
+    return false;
+  cur->off = (p - offsetof (DBuffer, data)) - cur->tape->data;
+  return true;
+}
+
+#ifdef TAPE_FILE
+TAPEMEMDEF int
+tape_open (Tape *tape, const char *path)
+{
+  struct stat st;
+  struct tape_fheader_t *hdr;
+  size_t cap = (0 == tape->cap) ? 4096 : tape->cap;
+  int fd;
+
+  if ((fd = open (path, O_RDWR | O_CREAT, 0644)) < 0)
+    return -1;
+  if (0 != fstat (fd, &st))
+    goto fail;
+
+  if (0 == st.st_size)
+    {
+      /* new tape */
+      if (0 != ftruncate (fd, __TAPE_FHDR + cap))
+        goto fail;
+    }
+  else if ((size_t)st.st_size <= __TAPE_FHDR)
+    {
+      /* not a tape, must not be overwritten */
+      errno = EINVAL;
+      goto fail;
+    }
+  else
+    cap = st.st_size - __TAPE_FHDR;
+
+  char *base = mmap (NULL, __TAPE_FHDR + cap, PROT_READ | PROT_WRITE,
+                     MAP_SHARED, fd, 0);
+  if (MAP_FAILED == base)
+    goto fail;
+
+  hdr = (struct tape_fheader_t *)base;
+  if (0 == st.st_size)
+    {
+      memcpy (hdr->magic, TAPE_MAGIC, sizeof (hdr->magic));
+      hdr->len = 0;
+    }
+  else if (0 != memcmp (hdr->magic, TAPE_MAGIC, sizeof (hdr->magic)))
+    {
+      munmap (base, __TAPE_FHDR + cap);
+      errno = EINVAL;
+      goto fail;
+    }
+
+  tape->fd = fd;
+  tape->cap = cap;
+  tape->data = base + __TAPE_FHDR;
+  tape->len = 0;
+  /* the header might be broken too */
+  if (hdr->len > cap)
+    hdr->len = cap;
+  /* drop incomplete records */
+  while (tape->len + sizeof (size_t) <= hdr->len && tape->len < cap)
+    {
+      size_t n = __tape_reclen (tape->data + tape->len);
+      if (0 == n || buffer_of_size (n) > BUF_MAX_LEN
+          || tape->len + buffer_of_size (n) > hdr->len)
+        break;
+      tape->len += buffer_of_size (n);
+    }
+  hdr->len = tape->len;
+
+  if (tape->index)
+    tape_index_build (tape);
+  return 0;
+
+ fail:
+  close (fd);
+  return -1;
+}
+
+TAPEMEMDEF int
+tape_sync (Tape *tape)
+{
+  if (-1 == tape->fd)
+    return -1;
+  return msync (tape->data - __TAPE_FHDR,
+                __TAPE_FHDR + tape->cap, MS_SYNC);
+}
+
+TAPEMEMDEF void
+tape_close (Tape *tape)
+{
+  if (-1 == tape->fd)
+    return;
+  munmap (tape->data - __TAPE_FHDR, __TAPE_FHDR + tape->cap);
+  close (tape->fd);
+  tape->fd = -1;
+  tape->data = NULL;
+  tape->len = 0;
+}
+#endif /* TAPE_FILE */
+
 #endif /* TAPE_MEM_IMPLEMENTATION */
 
 
@@ -216,8 +755,180 @@ main (void)
   data_at = tape_get (&mem, 4);
   assert (NULL == data_at);
   printf ("done\n");
+
+  printf ("testing cursor... ");
+  TapeCursor cur = tape_cursor (&mem);
+  assert (0 == strcmp (tape_next (&cur), "One"));
+  assert (0 == strcmp (tape_next (&cur), "2024"));
+  assert (0 == strcmp (tape_next (&cur), "XXX"));
+  assert (NULL == tape_next (&cur));
+  assert (tape_seek (&cur, 2));
+  assert (0 == strcmp (tape_next (&cur), "2024"));
+  assert (!tape_seek (&cur, 4));
+  printf ("done\n");
+
+  printf ("testing index... ");
+  char item[16];
+  size_t offsets[8];
+  TapeIndex index = new_tape_index (offsets, 8, 1);
+  mem.index = &index;
+  tape_index_build (&mem);
+  assert (3 == index.count && 3 == index.len);
+
+  tmp.data = item;
+  for (int i = 4; i <= 100; ++i)
+    {
+      tmp.len = 1 + snprintf (item, sizeof (item), "item-%d", i);
+      assert (NULL != tape_append (&mem, &tmp));
+    }
+  assert (100 == index.count && 16 == index.stride);
+  for (int i = 4; i <= 100; ++i)
+    {
+      snprintf (item, sizeof (item), "item-%d", i);
+      data_at = tape_get (&mem, i);
+      assert (NULL != data_at);
+      assert (0 == strcmp (data_at, item));
+    }
+  assert (0 == strcmp (tape_get (&mem, 2), "2024"));
+  assert (NULL == tape_get (&mem, 101));
+  assert (tape_seek (&cur, 100));
+  assert (0 == strcmp (tape_next (&cur), "item-100"));
+
+  /* growable offsets, the stride remains 1 */
+  TapeIndex full = new_tape_index (malloc (2 * sizeof (size_t)), 2, 1);
+  full.grow = realloc;
+  mem.index = &full;
+  tape_index_build (&mem);
+  assert (100 == full.count && 100 == full.len && 1 == full.stride);
+  for (int i = 4; i <= 100; ++i)
+    {
+      snprintf (item, sizeof (item), "item-%d", i);
+      assert (0 == strcmp (tape_get (&mem, i), item));
+    }
+  free (full.offs);
+  mem.index = &index;
+  printf ("done\n");
  
   free (mem.data);
+
+  printf ("testing batch append... ");
+  DBuffer batch[4] = {
+    {.len = 2, .data = "a"}, {.len = 3, .data = "bc"},
+    {.len = 4, .data = "def"}, {.len = 0, .data = ""},
+  };
+  mem = new_tape (96);
+  mem.data = malloc (mem.cap);
+  index = new_tape_index (offsets, 8, 1);
+  mem.index = &index;
+  assert (3 == tape_append_batch (&mem, batch, 4));
+  assert (0 == strcmp (tape_get (&mem, 3), "def"));
+  /* 96 bytes, room for two more items */
+  assert (2 == tape_append_batch (&mem, batch, 3));
+  assert (5 == index.count);
+  assert (0 == strcmp (tape_get (&mem, 5), "bc"));
+  printf ("done\n");
+
+#ifdef TAPE_FDIO
+  printf ("testing tape_readv... ");
+  int pfd[2];
+  size_t lens[] = {3, 5, 4, 8};
+  mem.len = 0;
+  tape_index_build (&mem);
+  assert (0 == pipe (pfd));
+  assert (11 == write (pfd[1], "ab\0cdef\0ghi", 11));
+  close (pfd[1]);
+  /* the last record is incomplete */
+  assert (2 == tape_readv (&mem, pfd[0], lens, 4));
+  close (pfd[0]);
+  assert (0 == strcmp (tape_get (&mem, 1), "ab"));
+  assert (0 == strcmp (tape_get (&mem, 2), "cdef"));
+  assert (NULL == tape_get (&mem, 3));
+  free (mem.data);
+
+  /* more records than a single readv batch */
+  size_t lens2[150];
+  char src[300];
+  for (int i = 0; i < 150; ++i)
+    {
+      lens2[i] = 2;
+      src[2*i] = 'a' + i % 26;
+      src[2*i + 1] = '\0';
+    }
+  mem = new_tape (4096);
+  mem.data = malloc (mem.cap);
+  assert (0 == pipe (pfd));
+  assert (300 == write (pfd[1], src, 300));
+  close (pfd[1]);
+  assert (150 == tape_readv (&mem, pfd[0], lens2, 150));
+  close (pfd[0]);
+  for (int i = 0; i < 150; ++i)
+    assert (tape_get (&mem, i + 1)[0] == 'a' + i % 26);
+  printf ("done\n");
+#endif /* TAPE_FDIO */
+  free (mem.data);
+
+#ifdef TAPE_FILE
+  printf ("testing file-backed tape... ");
+  char path[] = "/tmp/tape_test_XXXXXX";
+  close (mkstemp (path));
+
+  Tape log = new_tape (64);
+  assert (0 == tape_open (&log, path));
+  tmp.data = item;
+  for (int i = 1; i <= 200; ++i)
+    {
+      tmp.len = 1 + snprintf (item, sizeof (item), "log-%d", i);
+      assert (NULL != tape_append (&log, &tmp));
+    }
+  assert (log.cap >= log.len && 64 != log.cap);
+  assert (0 == tape_sync (&log));
+  tape_close (&log);
+
+  /* reopen, with an index */
+  log = new_tape (0);
+  index = new_tape_index (offsets, 8, 1);
+  log.index = &index;
+  assert (0 == tape_open (&log, path));
+  assert (200 == index.count);
+  for (int i = 1; i <= 200; ++i)
+    {
+      snprintf (item, sizeof (item), "log-%d", i);
+      assert (0 == strcmp (tape_get (&log, i), item));
+    }
+
+  /* a broken record at the end */
+  size_t good_len = log.len, bad = 1024;
+  memcpy (log.data + log.len, &bad, sizeof (bad));
+  tape_fheaderof (&log)->len += 64;
+  tape_close (&log);
+  log = new_tape (0);
+  assert (0 == tape_open (&log, path));
+  assert (good_len == log.len);
+
+  /* broken length in the header */
+  bad = 0;
+  memcpy (log.data + log.len, &bad, sizeof (bad));
+  tape_fheaderof (&log)->len = (size_t)-1;
+  tape_close (&log);
+  log = new_tape (0);
+  assert (0 == tape_open (&log, path));
+  assert (good_len == log.len);
+  tape_close (&log);
+
+  /* non-tape files (even smaller than the header) are not touched */
+  FILE *f = fopen (path, "w");
+  fputs ("this is not a tape file", f);
+  fclose (f);
+  log = new_tape (64);
+  assert (-1 == tape_open (&log, path) && EINVAL == errno);
+  f = fopen (path, "w");
+  fputs ("tiny", f);
+  fclose (f);
+  assert (-1 == tape_open (&log, path) && EINVAL == errno);
+  unlink (path);
+  printf ("done\n");
+#endif /* TAPE_FILE */
+
   return 0;
 }
 #endif /* TAPE_MEM_TEST */
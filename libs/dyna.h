@@ -86,6 +86,51 @@
     }
     ```
   
+    Small buffer:
+      `da_inline` declares an array with n cells inside a local
+      buffer (on the stack), it only allocates when it grows
+      beyond n cells, `da_free` is safe to call on it
+      ```c
+        da_inline (int, nums, 16);  // int *nums
+        for (int i=0; i < 10; ++i)
+          da_appd (nums, i);        // no allocation
+        da_free (nums);
+      ```
+      the array must not be used after its scope ends
+  
+    Allocators:
+      by default, arrays use `dyna_alloc`, `dyna_realloc` and
+      `dyna_free` macros (malloc), `da_newn_with` takes a
+      dyna_allocator instead, which applies to that array only
+      when `realloc` is NULL, it allocates and copies, and
+      when `free` is NULL, freeing is a no-op
+      to use an Arena (DS/arena.c), include arena.c before dyna.h
+      ```c
+        Arena A = new_arena ();
+        dyna_allocator al = da_arena_allocator (&A);
+        char **words = da_newn_with (char *, 32, &al);
+        ...
+        arena_free (&A);  // da_free (words) is not needed
+      ```
+  
+    Bulk operations:
+      to avoid reallocation and per-element overhead
+      ```c
+        int src[] = {1, 2, 3, 4};
+        int *arr = da_new (int);
+        da_reserve (arr, 1000);       // a single allocation
+        da_extend (arr, src, 4);      // arr: 1 2 3 4
+        da_insert_n (arr, 1, src, 2); // arr: 1 1 2 2 3 4
+        da_remove_n (arr, 0, 3);      // arr: 2 3 4
+      ```
+  
+    Test program:
+      ```{sh}
+        cc -ggdb -Wall -Wextra -Werror -D_ARENA_DEBUG \
+           -D DYNA_IMPLEMENTATION -D DYNA_TEST \
+           -x c -o test.out dyna.h
+      ```
+  
     Options:
       `_DA_DEBUG`:  to print some debugging information
       `DA_INICAP`:  the default initial capacity of arrays
@@ -127,6 +172,9 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdalign.h>
 
 #ifndef DADEFF
 # define DADEFF static inline
@@ -175,12 +223,29 @@
 # define dyna_free(p) free (p)
 #endif
 
+/**
+ *  custom allocator of arrays
+ *  @realloc and @free are optional (see the top of this file)
+ */
+typedef struct dyna_allocator_t
+{
+  void *(*alloc) (void *ctx, size_t size);
+  void *(*realloc) (void *ctx, void *ptr, size_t old, size_t size);
+  void (*free) (void *ctx, void *ptr);
+  void *ctx;
+} dyna_allocator;
+
+/* flags of arrays */
+#define DA_INLINE 0x1 /* memory is not owned by dyna (da_inline) */
+
 /* users don't need to work with this struct */
 typedef struct
 {
   da_idx cap; /* capacity of array */
   da_idx size; /* length of array */
   da_idx cell_bytes; /* size of each cell */
+  const dyna_allocator *al; /* NULL means dyna_alloc,... */
+  da_idx flags;
 
   /* actual bytes of array */
   char arr[];
@@ -206,7 +271,13 @@ typedef struct
  *  generic type purposes and safety
  */
 DADEFF dyna_t * __mk_da (da_sidx, da_sidx);
+DADEFF dyna_t * __mk_da_with (da_sidx, da_sidx, const dyna_allocator *);
+DADEFF void * __da_init (void *, da_sidx, da_sidx);
+DADEFF void __da_destroy (dyna_t *);
 DADEFF da_sidx __da_appd (void **);
+DADEFF int __da_reserve (void **, da_idx);
+DADEFF da_sidx __da_insert (void **, da_idx, const void *, da_idx);
+DADEFF void __da_remove (void *, da_idx, da_idx);
 DADEFF void * __da_funappd (void **, da_sidx);
 DADEFF void * __da_dup (void **);
 
@@ -220,7 +291,7 @@ DADEFF void * __da_dup (void **);
     if (DA_NNULL (arr)) {                          \
       dyna_t *__da__ = __DA_CONTAINEROF (arr);     \
       da_dprintf ("destroying %p\n", __da__);      \
-      dyna_free (__da__);                          \
+      __da_destroy (__da__);                       \
     }} while (0)
 
 // to get length and capacity of @arr
@@ -246,6 +317,26 @@ DADEFF void * __da_dup (void **);
       (T *)(__da__->arr);                         \
     })
 
+/**
+ *  the same as da_newn, using allocator @al
+ *  @al must outlive the array
+ */
+#define da_newn_with(T, n, al) ({                         \
+      dyna_t *__da__ = __mk_da_with (sizeof (T), n, al);  \
+      __da__ ? (T *)(__da__->arr) : NULL;                 \
+    })
+
+/**
+ *  declares @name, a `T *` array with @n inline cells
+ *  in the current scope, it spills to the heap on overflow
+ *  @n = 0 is treated as 1, like da_newn
+ */
+#define da_inline(T, name, n)                                   \
+  alignas (dyna_t) char __da_buf_##name[sizeof (dyna_t)         \
+                                        + ((n) ? (n) : 1)       \
+                                        * sizeof (T)];          \
+  T *name = (T *) __da_init (__da_buf_##name, sizeof (T), n)
+
 /**
  *  returns a pointer to a new dynamic array
  *  which is a duplicate of @arr
@@ -264,6 +355,31 @@ DADEFF void * __da_dup (void **);
       arr[__da_idx__] = val;                                \
     }} while (0)
 
+/**
+ *  make sure @arr has room for @n more cells
+ *  @return: 0 on success, -1 on failure
+ */
+#define da_reserve(arr, n) \
+  (DA_NNULL (arr) ? __da_reserve ((void **)&arr, n) : -1)
+
+/**
+ *  insert @n cells of @src (`T *`) at index @idx of @arr
+ *  @src may point into @arr itself (e.g. `da_extend (a, a, n)`)
+ *  with @src = NULL, cells are left uninitialized
+ *  @return: @idx on success, -1 on failure (or @idx > size)
+ */
+#define da_insert_n(arr, idx, src, n) \
+  (DA_NNULL (arr) ? __da_insert ((void **)&arr, idx, src, n) : -1)
+
+/* append @n cells of @src to @arr, similar to da_insert_n */
+#define da_extend(arr, src, n) da_insert_n (arr, da_sizeof (arr), src, n)
+
+/* remove @n cells of @arr starting from index @idx */
+#define da_remove_n(arr, idx, n) do {         \
+    if (DA_NNULL (arr))                       \
+      __da_remove ((void *)arr, idx, n);      \
+  } while (0)
+
 /**
  *  drop array
  *  only sets size of @arr to zero
@@ -289,18 +405,118 @@ DADEFF void * __da_dup (void **);
   } while (0)
 
 
+#if defined (DYNA_TEST) && !defined (ARENA_H__)
+/* the test program covers the Arena hook too */
+# define ARENA_IMPLEMENTATION
+# include "../DS/arena.c"
+#endif
+
+#ifdef ARENA_H__
+/**
+ *  internal, Arena hook
+ *  arena_alloc doesn't align the memory, so it's done here
+ *  and realloc is left to dyna (allocate and copy)
+ */
+static inline void *
+__da_arena_alloc (void *ctx, size_t size)
+{
+  const size_t align = alignof (max_align_t);
+  char *p = arena_alloc ((Arena *)ctx, size + align - 1, AUSE_MALLOC);
+  if (NULL == p)
+    return NULL;
+  return (void *)(((uintptr_t)p + align - 1) & ~(uintptr_t)(align - 1));
+}
+
+/* allocator of arrays that live in Arena @A */
+# define da_arena_allocator(A) (dyna_allocator) {   \
+    .alloc = __da_arena_alloc,                      \
+    .realloc = NULL,                                \
+    .free = NULL,                                   \
+    .ctx = (A),                                     \
+  }
+#endif /* ARENA_H__ */
+
+
 #ifdef DYNA_IMPLEMENTATION
 
+/* internal, memory management of arrays */
+static inline void *
+__da_mem_alloc (const dyna_allocator *al, size_t size)
+{
+  if (NULL == al)
+    return dyna_alloc (size);
+  return al->alloc (al->ctx, size);
+}
+
+static inline dyna_t *
+__da_mem_realloc (dyna_t *da, size_t old, size_t size)
+{
+  dyna_t *new_da;
+  const dyna_allocator *al = da->al;
+
+  if (0 == (da->flags & DA_INLINE))
+    {
+      if (NULL == al)
+        return dyna_realloc (da, size);
+      if (al->realloc)
+        return al->realloc (al->ctx, da, old, size);
+    }
+
+  /* spill to the heap, or allocate and copy */
+  if (!(new_da = __da_mem_alloc (al, size)))
+    return NULL;
+  memcpy (new_da, da, old);
+  if (0 == (da->flags & DA_INLINE) && al->free)
+    al->free (al->ctx, da);
+  new_da->flags &= ~DA_INLINE;
+  return new_da;
+}
+
+DADEFF void
+__da_destroy (dyna_t *da)
+{
+  if (da->flags & DA_INLINE)
+    return;
+  if (NULL == da->al)
+    dyna_free (da);
+  else if (da->al->free)
+    da->al->free (da->al->ctx, da);
+}
+
+DADEFF void *
+__da_init (void *buf, da_sidx cell_size, da_sidx n)
+{
+  dyna_t *da = (dyna_t *) buf;
+  if (0 == n)
+    n = 1; /* prevent 0 capacity, growing would never end */
+  da->cap = n;
+  da->size = 0;
+  da->cell_bytes = cell_size;
+  da->al = NULL;
+  da->flags = DA_INLINE;
+  return da->arr;
+}
+
 dyna_t *
 __mk_da(da_sidx cell_size, da_sidx n)
+{
+  return __mk_da_with (cell_size, n, NULL);
+}
+
+DADEFF dyna_t *
+__mk_da_with (da_sidx cell_size, da_sidx n, const dyna_allocator *al)
 {
   if (0 == n)
     n = 1; /* prevent 0 capacity initialization */
   size_t ptrlen = sizeof (dyna_t) + cell_size * n;
-  dyna_t *da = (dyna_t *) dyna_alloc (ptrlen);
+  dyna_t *da = (dyna_t *) __da_mem_alloc (al, ptrlen);
+  if (NULL == da)
+    return NULL;
   da->cap = n;
   da->size = 0;
   da->cell_bytes = cell_size;
+  da->al = al;
+  da->flags = 0;
 
   da_dprintf ("allocated @%p, cell_size: %luB, "
               "size: %luB (%luB metadata + %luB array)\n",
@@ -312,8 +528,8 @@ __mk_da(da_sidx cell_size, da_sidx n)
   return da;
 }
 
-DADEFF da_sidx
-__da_appd (void **arr)
+DADEFF int
+__da_reserve (void **arr, da_idx n)
 {
   dyna_t *da;
   size_t new_size;
@@ -321,18 +537,27 @@ __da_appd (void **arr)
   if (!(da = __DA_CONTAINEROF (*arr)))
     return -1;
 
-  if (da->size >= da->cap)
+  if (da->size + n > da->cap)
     {
-      da_dprintf ("overflow %p, size=cap:%lu, cell_size:%luB\n",
+      da_dprintf ("overflow %p, size:%lu + %lu, cap:%lu, cell_size:%luB\n",
                   da,
+                  (size_t) da->size,
+                  (size_t) n,
                   (size_t) da->cap,
                   (size_t) da->cell_bytes);
       {
-        DA_DO_GROW (da->cap);
+        size_t old_size = sizeof (dyna_t) + da->cap * da->cell_bytes;
+        da_idx old_cap = da->cap;
+        while (da->size + n > da->cap)
+          DA_DO_GROW (da->cap);
         new_size = sizeof (dyna_t) + da->cap * da->cell_bytes;
-        da = dyna_realloc (da, new_size);
-        if (!da)
-          return -1;
+        dyna_t *new_da = __da_mem_realloc (da, old_size, new_size);
+        if (!new_da)
+          {
+            da->cap = old_cap;
+            return -1;
+          }
+        da = new_da;
         *arr = da->arr;
       }
       da_dprintf ("realloc @%p, new size: %luB\n",
@@ -340,7 +565,65 @@ __da_appd (void **arr)
                   (size_t) new_size);
     }
 
-  return da->size++;
+  return 0;
+}
+
+DADEFF da_sidx
+__da_appd (void **arr)
+{
+  if (0 != __da_reserve (arr, 1))
+    return -1;
+  return __DA_CONTAINEROF (*arr)->size++;
+}
+
+DADEFF da_sidx
+__da_insert (void **arr, da_idx idx, const void *src, da_idx n)
+{
+  dyna_t *da = __DA_CONTAINEROF (*arr);
+  size_t len = n * da->cell_bytes, pos = idx * da->cell_bytes;
+  /**
+   *  when @src is within the array, it might get moved by
+   *  __da_reserve, so it's kept as an offset
+   */
+  int alias = (src && (const char *)src >= da->arr
+                && (const char *)src < da->arr + da->size * da->cell_bytes);
+  size_t off = alias ? (size_t)((const char *)src - da->arr) : 0;
+
+  if (idx > da->size || 0 != __da_reserve (arr, n))
+    return -1;
+
+  da = __DA_CONTAINEROF (*arr);
+  char *p = da->arr + pos;
+  memmove (p + len, p, (da->size - idx) * da->cell_bytes);
+  if (alias)
+    {
+      /* the part of @src after @idx was shifted by @len */
+      size_t before = (off < pos) ? pos - off : 0;
+      if (before > len)
+        before = len;
+      memmove (p, da->arr + off, before);
+      memmove (p + before, da->arr + off + before + len, len - before);
+    }
+  else if (src)
+    memcpy (p, src, len);
+  da->size += n;
+  return idx;
+}
+
+DADEFF void
+__da_remove (void *arr, da_idx idx, da_idx n)
+{
+  dyna_t *da = __DA_CONTAINEROF (arr);
+
+  if (idx >= da->size)
+    return;
+  if (n > da->size - idx)
+    n = da->size - idx;
+
+  char *p = da->arr + idx * da->cell_bytes;
+  memmove (p, p + n * da->cell_bytes,
+           (da->size - idx - n) * da->cell_bytes);
+  da->size -= n;
 }
 
 DADEFF void *
@@ -358,10 +641,182 @@ __da_dup (void **arr)
 {
   dyna_t *da = __DA_CONTAINEROF (*arr);
   size_t lenof_da = da->size * da->cell_bytes + sizeof (dyna_t);
-  dyna_t *new_da = malloc (lenof_da);
+  da_idx cap = da->size ? da->size : 1;
+  dyna_t *new_da = __da_mem_alloc (da->al, sizeof (dyna_t)
+                                   + cap * da->cell_bytes);
+  if (NULL == new_da)
+    return NULL;
   memcpy (new_da, da, lenof_da);
+  new_da->cap = cap;
+  new_da->flags &= ~DA_INLINE;
   return &new_da->arr;
 }
 
 #endif /* DYNA_IMPLEMENTATION */
 #endif /* DYNAMIC_ARRAY__H__ */
+
+
+#ifdef DYNA_TEST
+#include <stdio.h>
+
+#define da_assert(con) do {                                     \
+    if (!(con)) {                                               \
+      printf ("FAILED\n  %s:%d: `%s`\n", __FILE__, __LINE__, #con); \
+      return 1;                                                 \
+    }} while (0)
+
+/* @arr must hold the ints of @exp */
+#define da_equal(arr, ...) ({                                   \
+      const int __exp[] = {__VA_ARGS__};                        \
+      da_sizeof (arr) == sizeof (__exp) / sizeof (int)          \
+        && 0 == memcmp (arr, __exp, sizeof (__exp));            \
+    })
+
+int
+test_inline (void)
+{
+  da_inline (int, nums, 4);
+  const int *buf = nums;
+
+  for (int i=0; i < 4; ++i)
+    da_appd (nums, i);
+  da_assert (nums == buf); /* not allocated yet */
+  for (int i=4; i < 100; ++i)
+    da_appd (nums, i);
+  da_assert (nums != buf && 100 == da_sizeof (nums));
+  for (int i=0; i < 100; ++i)
+    da_assert (nums[i] == i);
+
+  int *dup = da_dup (nums);
+  da_free (nums);
+  da_assert (100 == da_sizeof (dup) && 99 == dup[99]);
+  da_free (dup);
+
+  /* not spilled, da_free is a no-op */
+  da_inline (int, small, 2);
+  da_appd (small, 1);
+  da_free (small);
+  return 0;
+}
+
+int
+test_zero_cap (void)
+{
+  da_inline (int, a, 0);
+  int *b = da_newn (int, 0);
+
+  for (int i=0; i < 10; ++i)
+    {
+      da_appd (a, i);
+      da_appd (b, i);
+    }
+  da_assert (da_equal (a, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9));
+  da_assert (da_equal (b, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9));
+  da_free (a);
+  da_free (b);
+  return 0;
+}
+
+int
+test_bulk (void)
+{
+  int src[] = {1, 2, 3, 4};
+  int *a = da_newn (int, 1);
+
+  da_assert (0 == da_reserve (a, 100) && 100 <= da_capof (a));
+  da_assert (0 == da_extend (a, src, 4));
+  da_assert (1 == da_insert_n (a, 1, src, 2));
+  da_assert (da_equal (a, 1, 1, 2, 2, 3, 4));
+  da_assert (-1 == da_insert_n (a, 7, src, 1));
+  da_assert (6 == da_sizeof (a));
+
+  /* removal is clamped to the end of the array */
+  da_remove_n (a, 0, 3);
+  da_assert (da_equal (a, 2, 3, 4));
+  da_remove_n (a, 1, 100);
+  da_assert (da_equal (a, 2));
+  da_remove_n (a, 5, 1);
+  da_assert (da_equal (a, 2));
+  da_free (a);
+  return 0;
+}
+
+int
+test_alias (void)
+{
+  /* with small capacities, so the array moves when it grows */
+  int *a = da_newn (int, 1);
+  for (int i=0; i < 4; ++i)
+    da_appd (a, i);
+  da_assert (4 == da_capof (a));
+  da_assert (4 == da_extend (a, a, 4));
+  da_assert (da_equal (a, 0, 1, 2, 3, 0, 1, 2, 3));
+  da_free (a);
+
+  /* @src before, around and after the insertion point */
+  a = da_newn (int, 1);
+  for (int i=0; i < 5; ++i)
+    da_appd (a, i);
+  da_assert (1 == da_insert_n (a, 1, a + 3, 2));
+  da_assert (da_equal (a, 0, 3, 4, 1, 2, 3, 4));
+  da_assert (5 == da_insert_n (a, 5, a, 2));
+  da_assert (da_equal (a, 0, 3, 4, 1, 2, 0, 3, 3, 4));
+  da_assert (2 == da_insert_n (a, 2, a + 1, 3));
+  da_assert (da_equal (a, 0, 3, 3, 4, 1, 4, 1, 2, 0, 3, 3, 4));
+  da_free (a);
+
+  da_inline (int, b, 2);
+  da_appd (b, 7);
+  da_appd (b, 8);
+  da_assert (0 == da_insert_n (b, 0, b, 2)); /* spills */
+  da_assert (da_equal (b, 7, 8, 7, 8));
+  da_free (b);
+  return 0;
+}
+
+int
+test_arena (void)
+{
+  Arena A = new_arena ();
+  dyna_allocator al = da_arena_allocator (&A);
+  char **w = da_newn_with (char *, 2, &al);
+  long *l = da_newn_with (long, 0, &al);
+
+  da_assert (NULL != w && NULL != l);
+  for (int i=0; i < 50; ++i)
+    {
+      da_appd (w, "x");
+      da_appd (l, i);
+    }
+  da_assert (50 == da_sizeof (w) && 'x' == w[49][0]);
+  da_assert (0 == (uintptr_t)__DA_CONTAINEROF (w) % alignof (max_align_t));
+  for (int i=0; i < 50; ++i)
+    da_assert (l[i] == i);
+
+  int *d = da_dup (l); /* also in the arena */
+  da_assert (50 == da_sizeof (d));
+  da_free (w); /* a no-op */
+  da_free (d);
+  arena_free (&A);
+  return 0;
+}
+
+int
+main (void)
+{
+  int (*tests[]) (void) = {
+    test_inline, test_zero_cap, test_bulk, test_alias, test_arena,
+  };
+  int ret = 0;
+
+  for (size_t i=0; i < sizeof (tests) / sizeof (*tests); ++i)
+    {
+      printf ("test %lu: ", i + 1);
+      if (0 == tests[i] ())
+        puts ("pass");
+      else
+        ret = 1;
+    }
+  return ret;
+}
+#endif /* DYNA_TEST */
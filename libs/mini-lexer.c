@@ -78,6 +78,9 @@
         .a_comment     = GEN_MKCFG (ML_Comments),
         .delim_ranges  = GEN_MKCFG (Delimiters),
       };
+      // Optional, to use lookup tables instead of
+      // scanning every pattern for each input byte
+      ml_compile (&ml);
   
       //-- Actual Parsing --------------//
       const int flg = PFLAG_DEFAULT;
@@ -107,6 +110,7 @@
             }
         }
       TOKEN_FREE (&tk);
+      ml_uncompile (&ml);
     ```
   
     Known Issues:
@@ -158,6 +162,32 @@
         } while (!NEXT_SHOULD_LOAD (ret));
     ```
   
+    Zero-copy tokens:
+      With a compiled configuration, the `PFLAG_ZEROCOPY` flag makes
+      the result point into the input buffer, so use `tk.ptr` and
+      `tk.len` instead of `tk.cstr`; the result is not null-terminated
+    ```{c}
+      ml_compile (&ml);
+      ret = ml_next (&ml, &src, &tk, PFLAG_ZEROCOPY);
+      printf ("%.*s\n", (int) tk.len, tk.ptr);
+    ```
+
+    Push-style parsing:
+      ml_feed lexes whole buffers and delivers the results
+      in batches to a callback, instead of the ml_next loop
+    ```{c}
+      int on_tokens (const Milexer_Result *res, size_t n, void *arg)
+      {
+        for (size_t i=0; i < n; ++i)
+          printf ("%.*s\n", (int) res[i].len, res[i].ptr);
+        return 0;
+      }
+      ...
+      Milexer_Feed f = {.tk_cap = 32, .emit = on_tokens};
+      ml_feed (&ml, &f, buffer, buffer_length); // as many as needed
+      ml_feed (&ml, &f, NULL, 0); // end of input
+    ```
+  
     Compilation:
      The test program:
        cc -O0 -ggdb -Wall -Wextra -Werror \
@@ -165,9 +195,20 @@
           mini-lexer.c -o test.out
      The example program:
        pass `-D ML_EXAMPLE_1` instead of `ML_TEST_1`
+     The benchmark program:
+       cc -O2 -D ML_IMPLEMENTATION -D ML_BENCH \
+          mini-lexer.c -o bench.out
+       ./bench.out golden.txt
+       the first run records tokens of the generated corpora in
+       golden.txt, next runs (after changing the lexer) compare
+       against it; use -D BENCH_SIZE=n for the corpus length
   
      Compilation Options:
        Debug Info:  define `-D_ML_DEBUG`
+       Vectorized scanning of compiled configurations:
+         pass `-mssse3` or `-mavx2` (or `-march=native`)
+       Parallel lexing of large inputs (ml_parallel):
+         define `-D ML_PARALLEL` and pass `-pthread`
  **/
 #ifndef MINI_LEXER__H
 #define MINI_LEXER__H
@@ -175,6 +216,9 @@
 #include <string.h>
 #include <stddef.h>
 #include <stdbool.h>
+#if defined (__AVX2__) || defined (__SSSE3__)
+#  include <immintrin.h>
+#endif
 
 #ifdef _ML_DEBUG
 #  include <stdio.h>
@@ -332,6 +376,16 @@ enum milexer_parsing_flag_t
      *  which are ignored by default
      */
     PFLAG_INCOMMENT =  __flag__ (3),
+
+    /**
+     *  Zero-copy tokens, only with compiled configurations
+     *  The result (@t->ptr, @t->len) points into @src->buffer,
+     *  it is valid until the next load, and @t->cstr is NOT updated
+     *  Tokens are only copied into @t->cstr when they span
+     *  a lazy-load boundary, and they are no longer fragmented
+     *  into chunks, unless they span a load and do not fit in @t->cstr
+     */
+    PFLAG_ZEROCOPY =   __flag__ (4),
   };
 
 enum milexer_token_t
@@ -374,8 +428,19 @@ typedef struct
   char *cstr;
   size_t cap;
 
+  /**
+   *  The result, @len bytes at @ptr
+   *  @ptr is @cstr, unless PFLAG_ZEROCOPY is used
+   */
+  const char *ptr;
+  size_t len;
+
   /* Internal */
   size_t __idx;
+  /* automaton states, only used when compiled */
+  unsigned short __ac, __ac_exp;
+  /* the text is in @cstr, in zero-copy mode */
+  bool __spill;
 } Milexer_Token;
 
 /* to allocate/free a token using malloc */
@@ -384,14 +449,20 @@ typedef struct
 #define TOKEN_FREE(t) if ((t)->cstr) {free ((t)->cstr);}
 /* to only drop contents of a token */
 #define TOKEN_DROP(t) \
-  ((t)->__idx = 0, (t)->len = 0, \
+  ((t)->__idx = 0, (t)->len = 0, (t)->ptr = (t)->cstr, \
+   (t)->__ac = 0, (t)->__ac_exp = 0, (t)->__spill = 0, \
    (t)->type = TK_NOT_SET, (t)->cstr[0] = '\0')
 /* to check if the token @t is defined in Milexer language */
 #define TOKEN_IS_KNOWN(t) ((t)->id >= 0)
 
 /* Internal macros */
 #define TOKEN_FINISH(t) \
-  ((t)->cstr[(t)->__idx] = 0 , (t)->__idx = 0)
+  ((t)->cstr[(t)->__idx < (t)->cap ? (t)->__idx : (t)->cap] = 0, \
+   (t)->len = (t)->__idx, (t)->__idx = 0, \
+   (t)->__ac = 0, (t)->__ac_exp = 0, (t)->__spill = 0)
+/* to end the result at offset @n */
+#define TOKEN_CUT(t, zc, n) \
+  ((t)->len = (n), (zc) ? 0 : ((t)->cstr[(t)->len] = '\0'))
 
 typedef struct
 {
@@ -439,6 +510,65 @@ typedef struct
 #define __get_last_punc(ml, src) \
   ((ml)->puncs.exp[(src)->__last_punc_idx])
 
+/* byte classes, see Milexer_Compiled */
+enum milexer_byte_class_t
+  {
+    MLC_DELIM = __flag__ (0), /* within delim_ranges */
+    MLC_CTRL  = __flag__ (1), /* default delimiters, below space */
+    MLC_SPACE = __flag__ (2), /* the space character */
+    /* the first byte of patterns, the escape and null-byte */
+    MLC_SPECIAL = __flag__ (3),
+  };
+
+/**
+ *  Compiled form of a Milexer configuration, see `ml_compile`
+ *
+ *  Punctuations, comment prefixes and expression prefixes
+ *  are merged into a single Aho-Corasick automaton, so the
+ *  parser takes one transition per input byte, regardless of
+ *  the number of the patterns
+ *  Delimiters are looked up in @cls, the MLC_xxx class of each byte
+ *  and keyword IDs in the hash table @kw
+ */
+typedef struct
+{
+  unsigned char cls[256];
+  /**
+   *  Nibble bitmaps of the bytes that stop the fast scanning
+   *  of token bodies, indexed by the delimiter classes in use
+   *  byte b is a stop byte, when the bit `b >> 4` is set in
+   *  lo[b & 0xF] (b < 0x80), or in hi[b & 0xF] (b >= 0x80)
+   */
+  struct ml_span_t
+  {
+    unsigned char lo[16], hi[16];
+  } span[8];
+
+  size_t nstates;
+  /* transitions, delta[state][byte] */
+  unsigned short (*delta)[256];
+  /* patterns that end at each state, -1 means none */
+  struct ml_match_t
+  {
+    short punc;   /* the longest punctuation */
+    short b_comm; /* the first single-line comment */
+    short a_comm; /* the first multi-line comment prefix */
+    short exp;    /* the first expression prefix */
+  } *out;
+
+  /**
+   *  Keywords, open addressing hash table of FNV-1a hashes
+   *  @kwcap is a power of two, and larger than the number
+   *  of the keywords, so probing always reaches an empty slot
+   */
+  struct ml_kw_t
+  {
+    int id;     /* index of the keyword, -1 means empty */
+    size_t len;
+  } *kw;
+  size_t kwcap;
+} Milexer_Compiled;
+
 typedef struct Milexer_t
 {
   /* Configurations */
@@ -458,6 +588,8 @@ typedef struct Milexer_t
    */
   Milexer_BEXP delim_ranges;
 
+  /* Internal, see ml_compile */
+  Milexer_Compiled *__compiled;
 } Milexer;
 
 #define GEN_LENOF(arr) (sizeof (arr) / sizeof ((arr)[0]))
@@ -476,7 +608,21 @@ typedef struct Milexer_t
 int milexer_init (Milexer *, bool lazy_mode);
 
 /**
- *  To set the ID of keyword tokens
+ *  Compiles the configuration of @ml into lookup tables,
+ *  which ml_next uses instead of scanning the patterns
+ *  This is optional, and must be done again whenever
+ *  the configuration of @ml is modified
+ *
+ *  @return 0 on success, -1 on failure
+ *  in that case, @ml remains usable but not compiled
+ */
+int ml_compile (Milexer *ml);
+
+/* frees the tables allocated by ml_compile */
+void ml_uncompile (Milexer *ml);
+
+/**
+ *  To set the ID of keyword tokens, based on @t->ptr and @t->len
  *  @return 0 on success, -1 if not detected
  */
 int ml_set_keyword_id (const Milexer *, Milexer_Token *t);
@@ -495,18 +641,412 @@ int ml_next (const Milexer *,
              Milexer_Slice *src, Milexer_Token *t,
              int flags);
 
+/**
+ *  A retrieved token, the return value of ml_next
+ *  and (@type, @id, @ptr, @len) of its result
+ */
+typedef struct
+{
+  int ret; /* NEXT_MATCH, NEXT_CHUNK, NEXT_ZTERM or NEXT_END */
+  enum milexer_token_t type;
+  int id;
+  const char *ptr;
+  size_t len;
+} Milexer_Result;
+
+/**
+ *  To receive @n results at once, a non-zero
+ *  return value stops the parser, see ml_feed
+ */
+typedef int (*ml_emit_t) (const Milexer_Result *res, size_t n, void *arg);
+
+/* maximum number of results in each call of ml_feed's @emit */
+#ifndef ML_FEED_BATCH
+#  define ML_FEED_BATCH 256
+#endif
+
+typedef struct
+{
+  int flags;       /* parsing flags, PFLAG_xxx */
+  size_t tk_cap;   /* capacity of the token buffer */
+  ml_emit_t emit;
+  void *arg;
+
+  /* Internal */
+  Milexer_Slice __src;
+  Milexer_Token __tk;
+  Milexer_Result *__res;
+  size_t __n;
+  /* copies of the results that are not in the input */
+  char *__text;
+  size_t __tlen, __tcap;
+} Milexer_Feed;
+
+/**
+ *  Push-style parsing: lexes @len bytes of @buf, from where
+ *  the previous call has left, and delivers the results
+ *  in batches to @f->emit, instead of one ml_next call per token
+ *
+ *  Results are only valid within @f->emit
+ *  Pass @buf=NULL to end the input, this delivers the last
+ *  token and frees @f; it must be called, even after failures
+ *
+ *  @return 0 on success, -1 on failure, or
+ *  the first non-zero return value of @f->emit
+ *
+ *  Example:
+ *    Milexer_Feed f = {.tk_cap = 64, .emit = on_tokens};
+ *    while ((n = read (fd, buf, sizeof (buf))) > 0)
+ *      if (ml_feed (&ml, &f, buf, n) != 0)
+ *        break;
+ *    ml_feed (&ml, &f, NULL, 0);
+ */
+int ml_feed (const Milexer *ml, Milexer_Feed *f,
+             const char *buf, size_t len);
+
+#ifdef ML_PARALLEL
+/* the default chunk size of ml_parallel */
+#  ifndef ML_PARALLEL_CHUNK
+#    define ML_PARALLEL_CHUNK (4 * 1024 * 1024) // 4Mb
+#  endif
+
+typedef struct
+{
+  int flags;       /* parsing flags, PFLAG_xxx */
+  size_t tk_cap;   /* capacity of the token buffers */
+  int nthreads;
+  size_t chunk;    /* approximate length of chunks */
+  /**
+   *  In the ordered mode, @emit is called for each chunk
+   *  in the input order, by the calling thread
+   *  Otherwise, it is called concurrently by the worker threads
+   */
+  bool ordered;
+  ml_emit_t emit;
+  void *arg;
+} Milexer_Parallel;
+
+/**
+ *  Parallel lexing of the whole input @buf of length @len
+ *
+ *  The input is split into chunks after delimiters, and every
+ *  @opt->nthreads chunks are lexed on worker threads, each one
+ *  from the initial state; then a chunk that follows the end of
+ *  another one in the middle of a token, an expression or
+ *  a comment, is lexed again from where that chunk has ended,
+ *  so the results are the same as lexing @buf using ml_next
+ *
+ *  Results are valid only within @opt->emit
+ *  Memory usage is bounded by @opt->nthreads chunks at a time
+ *
+ *  @return 0 on success, -1 on failure, or
+ *  the first non-zero return value of @opt->emit
+ */
+int ml_parallel (const Milexer *ml, const char *buf, size_t len,
+                 const Milexer_Parallel *opt);
+#endif /* ML_PARALLEL */
+
 
 /**
  **  Internal functions
  **/
 #ifdef ML_IMPLEMENTATION
 
+#ifndef ml_alloc
+#  include <stdlib.h>
+#  define ml_alloc(s) malloc (s)
+#  define ml_free(p) free (p)
+#endif
+
+/* adds @pat to the trie of @mc, returns the state of its end */
+static inline unsigned short
+__ml_trie_add (Milexer_Compiled *mc, const char *pat)
+{
+  unsigned short s = 0;
+  for (const unsigned char *p = (const unsigned char *)pat; *p; ++p)
+    {
+      if (mc->delta[s][*p] == 0)
+        {
+          mc->out[mc->nstates] = (struct ml_match_t){-1, -1, -1, -1};
+          mc->delta[s][*p] = mc->nstates++;
+        }
+      s = mc->delta[s][*p];
+    }
+  return s;
+}
+
+/* FNV-1a hash of keywords */
+static inline size_t
+__ml_hash (const char *p, size_t len)
+{
+  unsigned int h = 0x811c9dc5;
+  for (size_t i=0; i < len; ++i)
+    h = (h ^ (unsigned char)p[i]) * 0x01000193;
+  return h;
+}
+
+/* the lower one of two pattern indices, -1 means none */
+#define __ml_first(a, b) \
+  ((a) < 0 ? (b) : ((b) < 0 || (a) < (b)) ? (a) : (b))
+
+int
+ml_compile (Milexer *ml)
+{
+  size_t n = 1;
+  ml_uncompile (ml);
+  for (int i=0; i < ml->puncs.len; ++i)
+    n += strlen (ml->puncs.exp[i]);
+  for (int i=0; i < ml->b_comment.len; ++i)
+    n += strlen (ml->b_comment.exp[i]);
+  for (int i=0; i < ml->a_comment.len; ++i)
+    n += strlen (ml->a_comment.exp[i].begin);
+  for (int i=0; i < ml->expression.len; ++i)
+    n += strlen (ml->expression.exp[i].begin);
+  if (n > 0xFFFF)
+    return -1;
+  size_t kwcap = 1;
+  while (kwcap <= 2 * (size_t)ml->keywords.len)
+    kwcap <<= 1;
+
+  Milexer_Compiled *mc = ml_alloc (sizeof (Milexer_Compiled)
+                                   + n * sizeof (*mc->delta)
+                                   + n * sizeof (*mc->out)
+                                   + kwcap * sizeof (*mc->kw));
+  unsigned short *queue = ml_alloc (2 * n * sizeof (unsigned short));
+  if (!mc || !queue)
+    {
+      if (mc)
+        ml_free (mc);
+      if (queue)
+        ml_free (queue);
+      return -1;
+    }
+  unsigned short *fail = queue + n;
+  mc->delta = (void *)(mc + 1);
+  mc->out = (void *)(mc->delta + n);
+  mc->kw = (void *)(mc->out + n);
+  mc->kwcap = kwcap;
+  memset (mc->delta, 0, n * sizeof (*mc->delta));
+  mc->out[0] = (struct ml_match_t){-1, -1, -1, -1};
+  mc->nstates = 1;
+
+  /* delimiters, the same as __detect_delim */
+  memset (mc->cls, 0, sizeof (mc->cls));
+  memset (mc->cls, MLC_CTRL, ' ');
+  mc->cls[' '] = MLC_SPACE;
+  for (int i=0; i < ml->delim_ranges.len; ++i)
+    {
+      const unsigned char *__p =
+        (const unsigned char *) ml->delim_ranges.exp[i];
+      if (__p[1] != '\0')
+        {
+          for (int c = __p[0]; c <= __p[1]; ++c)
+            mc->cls[c] |= MLC_DELIM;
+        }
+      else
+        mc->cls[__p[0]] |= MLC_DELIM;
+    }
+  mc->cls[0] |= MLC_SPECIAL;
+  mc->cls['\\'] |= MLC_SPECIAL;
+
+  /* the trie, empty patterns never match */
+  unsigned short s;
+  for (int i=0; i < ml->puncs.len; ++i)
+    if ((s = __ml_trie_add (mc, ml->puncs.exp[i])))
+      mc->out[s].punc = i;
+  for (int i=0; i < ml->b_comment.len; ++i)
+    if ((s = __ml_trie_add (mc, ml->b_comment.exp[i])))
+      mc->out[s].b_comm = __ml_first (mc->out[s].b_comm, i);
+  for (int i=0; i < ml->a_comment.len; ++i)
+    if ((s = __ml_trie_add (mc, ml->a_comment.exp[i].begin)))
+      mc->out[s].a_comm = __ml_first (mc->out[s].a_comm, i);
+  for (int i=0; i < ml->expression.len; ++i)
+    if ((s = __ml_trie_add (mc, ml->expression.exp[i].begin)))
+      mc->out[s].exp = __ml_first (mc->out[s].exp, i);
+
+  /**
+   *  Failure links in BFS order; each state also inherits
+   *  the matches of its failure state, as they are
+   *  the shorter suffixes of the same input
+   */
+  size_t head = 0, tail = 0;
+  for (int c=0; c < 256; ++c)
+    if ((s = mc->delta[0][c]))
+      fail[s] = 0, queue[tail++] = s;
+  while (head < tail)
+    {
+      unsigned short q = queue[head++];
+      struct ml_match_t *o = mc->out + q, *f = mc->out + fail[q];
+      if (o->punc < 0)
+        o->punc = f->punc;
+      o->b_comm = __ml_first (o->b_comm, f->b_comm);
+      o->a_comm = __ml_first (o->a_comm, f->a_comm);
+      o->exp = __ml_first (o->exp, f->exp);
+
+      for (int c=0; c < 256; ++c)
+        {
+          if ((s = mc->delta[q][c]))
+            {
+              fail[s] = mc->delta[fail[q]][c];
+              queue[tail++] = s;
+            }
+          else
+            mc->delta[q][c] = mc->delta[fail[q]][c];
+        }
+    }
+
+  /* keywords, the first one wins, the same as ml_set_keyword_id */
+  for (size_t i=0; i < kwcap; ++i)
+    mc->kw[i].id = -1;
+  for (int i=0; i < ml->keywords.len; ++i)
+    {
+      const char *p = ml->keywords.exp[i];
+      size_t len = strlen (p);
+      size_t h = __ml_hash (p, len) & (kwcap - 1);
+      for (; mc->kw[h].id >= 0; h = (h + 1) & (kwcap - 1))
+        if (mc->kw[h].len == len
+            && memcmp (ml->keywords.exp[mc->kw[h].id], p, len) == 0)
+          break;
+      if (mc->kw[h].id < 0)
+        mc->kw[h] = (struct ml_kw_t){i, len};
+    }
+
+  /* the stop bytes of __ml_span */
+  memset (mc->span, 0, sizeof (mc->span));
+  for (int c=0; c < 256; ++c)
+    {
+      if (mc->delta[0][c])
+        mc->cls[c] |= MLC_SPECIAL;
+      for (int m=0; m < 8; ++m)
+        if (mc->cls[c] & (m | MLC_SPECIAL))
+          {
+            if (c < 0x80)
+              mc->span[m].lo[c & 0xF] |= 1 << (c >> 4);
+            else
+              mc->span[m].hi[c & 0xF] |= 1 << ((c >> 4) - 8);
+          }
+    }
+
+  ml_free (queue);
+  ml->__compiled = mc;
+  return 0;
+}
+
+void
+ml_uncompile (Milexer *ml)
+{
+  if (ml->__compiled)
+    ml_free (ml->__compiled);
+  ml->__compiled = NULL;
+}
+
+/**
+ *  Advances the automaton states of @tk by @c
+ *  Expression prefixes must begin after the last
+ *  escaped character, so they have their own state
+ */
+static inline void
+__ml_step (const Milexer_Compiled *mc, const Milexer_Slice *src,
+           Milexer_Token *tk, unsigned char c)
+{
+  tk->__ac = mc->delta[tk->__ac][c];
+  if (c == '\\' || src->state == SYN_ESCAPE)
+    tk->__ac_exp = 0;
+  else
+    tk->__ac_exp = mc->delta[tk->__ac_exp][c];
+}
+
+/* byte classes of @cls that are delimiters under @flags */
+static inline int
+__ml_delim_mask (const Milexer *ml, int flags)
+{
+  int mask = 0;
+  if (ml->delim_ranges.len == 0 || HAS_FLAG (flags, PFLAG_ALLDELIMS))
+    {
+      mask |= MLC_CTRL;
+      if (!HAS_FLAG (flags, PFLAG_IGSPACE))
+        mask |= MLC_SPACE;
+    }
+  if (ml->delim_ranges.len > 0 || HAS_FLAG (flags, PFLAG_ALLDELIMS))
+    mask |= MLC_DELIM;
+  return mask;
+}
+
+#if defined (__AVX2__) || defined (__SSSE3__)
+/**
+ *  Bitmask of the stop bytes within @v, by looking up
+ *  both nibbles of each byte in the tables @lo and @hi
+ */
+#  ifdef __AVX2__
+#    define __ml_vec __m256i
+#    define __ml_v(op) _mm256_##op
+#    define __ml_vsi(op) _mm256_##op##_si256
+#    define __ml_vtab(t) \
+  _mm256_broadcastsi128_si256 (_mm_loadu_si128 ((const __m128i *)(t)))
+#  else
+#    define __ml_vec __m128i
+#    define __ml_v(op) _mm_##op
+#    define __ml_vsi(op) _mm_##op##_si128
+#    define __ml_vtab(t) _mm_loadu_si128 ((const __m128i *)(t))
+#  endif
+static inline unsigned int
+__ml_stops (__ml_vec v, __ml_vec lo, __ml_vec hi)
+{
+  const __ml_vec nib = __ml_v (set1_epi8) (0x0F);
+  const __ml_vec bits = __ml_vtab ("\x01\x02\x04\x08\x10\x20\x40\x80"
+                                   "\x01\x02\x04\x08\x10\x20\x40\x80");
+  __ml_vec l = __ml_vsi (and) (v, nib);
+  __ml_vec h = __ml_vsi (and) (__ml_v (srli_epi16) (v, 4), nib);
+  __ml_vec upper = __ml_v (cmpgt_epi8) (h, __ml_v (set1_epi8) (7));
+  __ml_vec row = __ml_vsi (or)
+    (__ml_vsi (and) (upper, __ml_v (shuffle_epi8) (hi, l)),
+     __ml_vsi (andnot) (upper, __ml_v (shuffle_epi8) (lo, l)));
+  __ml_vec bit = __ml_v (shuffle_epi8) (bits, h);
+  return __ml_v (movemask_epi8)
+    (__ml_v (cmpeq_epi8) (__ml_vsi (and) (row, bit), bit));
+}
+#endif
+
+/**
+ *  Returns the length of the leading run of @s, at most @n bytes,
+ *  without any byte of the classes @MLC_SPECIAL and @delims
+ *  Such a run cannot change the state of the parser in SYN_MIDDLE
+ */
+static inline size_t
+__ml_span (const Milexer_Compiled *mc, int delims,
+           const char *s, size_t n)
+{
+  size_t i = 0;
+  const unsigned char *p = (const unsigned char *) s;
+#if defined (__AVX2__) || defined (__SSSE3__)
+  const __ml_vec lo = __ml_vtab (mc->span[delims].lo);
+  const __ml_vec hi = __ml_vtab (mc->span[delims].hi);
+  for (; i + sizeof (__ml_vec) <= n; i += sizeof (__ml_vec))
+    {
+      unsigned int m = __ml_stops (__ml_vsi (loadu)
+                                   ((const __ml_vec *)(p + i)), lo, hi);
+      if (m)
+        return i + __builtin_ctz (m);
+    }
+#endif
+  for (; i < n; ++i)
+    if (mc->cls[p[i]] & (delims | MLC_SPECIAL))
+      break;
+  return i;
+}
+
 /* returns @p when @p is a delimiter, and -1 on null-byte */
 static inline int
 __detect_delim (const Milexer *ml, unsigned char p, int flags)
 {
   if (p == 0)
     return -1;
+  if (ml->__compiled)
+    {
+      if (ml->__compiled->cls[p] & __ml_delim_mask (ml, flags))
+        return p;
+      return 0;
+    }
   if (ml->delim_ranges.len == 0 || HAS_FLAG (flags, PFLAG_ALLDELIMS))
     {
       /* default delimiters */
@@ -533,40 +1073,46 @@ __detect_delim (const Milexer *ml, unsigned char p, int flags)
   return 0;
 }
 
-static inline char *
+static inline const char *
 __detect_puncs (const Milexer *ml, Milexer_Slice *src,
                 Milexer_Token *res)
 {
   int longest_match_idx = -1;
   size_t longest_match_len = 0;
-  res->cstr[res->__idx] = '\0';
-  for (int i=0; i < ml->puncs.len; ++i)
+  if (ml->__compiled)
     {
-      const char *punc = ml->puncs.exp[i];
-      size_t len = strlen (punc);
-      if (res->__idx < len)
-        continue;
-      char *p = res->cstr + res->__idx - len;
-      if (strncmp (punc, p, len) == 0)
-        {
-          if (len >= longest_match_len)
-            {
-              longest_match_len = len;
-              longest_match_idx = i;
-            }
-        }
+      longest_match_idx = ml->__compiled->out[res->__ac].punc;
+      if (longest_match_idx != -1)
+        longest_match_len = strlen (ml->puncs.exp[longest_match_idx]);
     }
+  else
+    for (int i=0; i < ml->puncs.len; ++i)
+      {
+        const char *punc = ml->puncs.exp[i];
+        size_t len = strlen (punc);
+        if (res->__idx < len)
+          continue;
+        const char *p = res->ptr + res->__idx - len;
+        if (strncmp (punc, p, len) == 0)
+          {
+            if (len >= longest_match_len)
+              {
+                longest_match_len = len;
+                longest_match_idx = i;
+              }
+          }
+      }
 
   if (longest_match_idx != -1)
     {
       src->__last_punc_idx = longest_match_idx;
       res->id = longest_match_idx;
-      return res->cstr + (res->__idx - longest_match_len);
+      return res->ptr + (res->__idx - longest_match_len);
     }
   return NULL;
 }
 
-static inline char *
+static inline const char *
 __is_expression_suff (const Milexer *ml, Milexer_Slice *src,
                      Milexer_Token *tk)
 {
@@ -577,9 +1123,7 @@ __is_expression_suff (const Milexer *ml, Milexer_Slice *src,
   if (tk->__idx < len)
     return NULL;;
   
-  char *p = tk->cstr + tk->__idx;
-  *p = '\0';
-  p -= len;
+  const char *p = tk->ptr + tk->__idx - len;
   if (tk->__idx - len >= 1 && *p == '\\')
     return NULL;
 
@@ -591,7 +1135,7 @@ __is_expression_suff (const Milexer *ml, Milexer_Slice *src,
   return NULL;
 }
 
-static inline char *
+static inline const char *
 __is_mline_commented_suff (const Milexer *ml, Milexer_Slice *src,
                        Milexer_Token *tk)
 {
@@ -599,7 +1143,9 @@ __is_mline_commented_suff (const Milexer *ml, Milexer_Slice *src,
     {
       const char *pref = ml->a_comment.exp[i].end;
       size_t len = strlen (pref);
-      char *__cstr = tk->cstr + tk->__idx - len;
+      if (tk->__idx < len)
+        continue;
+      const char *__cstr = tk->ptr + tk->__idx - len;
 
       if (strncmp (pref, __cstr, len) == 0)
         {
@@ -610,15 +1156,25 @@ __is_mline_commented_suff (const Milexer *ml, Milexer_Slice *src,
   return NULL;
 }
 
-static inline char *
+static inline const char *
 __is_sline_commented_pref (const Milexer *ml, Milexer_Slice *src,
                        Milexer_Token *tk)
 {
+  if (ml->__compiled)
+    {
+      int i = ml->__compiled->out[tk->__ac].b_comm;
+      if (i < 0)
+        return NULL;
+      src->__last_comm = ml->b_comment.exp[i];
+      return tk->ptr + tk->__idx - strlen (src->__last_comm);
+    }
   for (int i=0; i < ml->b_comment.len; ++i)
     {
       const char *pref = ml->b_comment.exp[i];
       size_t len = strlen (pref);
-      char *__cstr = tk->cstr + tk->__idx - len;
+      if (len > tk->__idx)
+        continue;
+      const char *__cstr = tk->ptr + tk->__idx - len;
 
       if (strncmp (pref, __cstr, len) == 0)
         {
@@ -629,15 +1185,25 @@ __is_sline_commented_pref (const Milexer *ml, Milexer_Slice *src,
   return NULL;
 }
 
-static inline char *
+static inline const char *
 __is_mline_commented_pref (const Milexer *ml, Milexer_Slice *src,
                        Milexer_Token *tk)
 {
+  if (ml->__compiled)
+    {
+      int i = ml->__compiled->out[tk->__ac].a_comm;
+      if (i < 0)
+        return NULL;
+      src->__last_comm = ml->a_comment.exp[i].begin;
+      return tk->ptr + tk->__idx - strlen (src->__last_comm);
+    }
   for (int i=0; i < ml->a_comment.len; ++i)
     {
       const char *pref = ml->a_comment.exp[i].begin;
       size_t len = strlen (pref);
-      char *__cstr = tk->cstr + tk->__idx - len;
+      if (len > tk->__idx)
+        continue;
+      const char *__cstr = tk->ptr + tk->__idx - len;
 
       if (strncmp (pref, __cstr, len) == 0)
         {
@@ -648,12 +1214,21 @@ __is_mline_commented_pref (const Milexer *ml, Milexer_Slice *src,
   return NULL;
 }
 
-static inline char *
+static inline const char *
 __is_expression_pref (const Milexer *ml, Milexer_Slice *src,
                      Milexer_Token *tk)
 {
   /* looking for opening, O(ml->expression.len) */
   char *p;
+  if (ml->__compiled)
+    {
+      /* O(1), only the prefixes ending at the current byte */
+      int i = ml->__compiled->out[tk->__ac_exp].exp;
+      if (i < 0)
+        return NULL;
+      src->__last_exp_idx = i;
+      return tk->ptr + tk->__idx - strlen (ml->expression.exp[i].begin);
+    }
   char *__cstr = tk->cstr;
   __cstr[tk->__idx] = '\0';
   if ((p = strrchr (__cstr, '\\')))
@@ -679,12 +1254,28 @@ ml_set_keyword_id (const Milexer *ml, Milexer_Token *res)
 {
   if (res->type != TK_KEYWORD)
     return -1;
-  if (ml->keywords.len > 0)
+  if (ml->__compiled && ml->keywords.len > 0)
+    {
+      const Milexer_Compiled *mc = ml->__compiled;
+      size_t h = __ml_hash (res->ptr, res->len) & (mc->kwcap - 1);
+      for (; mc->kw[h].id >= 0; h = (h + 1) & (mc->kwcap - 1))
+        {
+          if (mc->kw[h].len == res->len
+              && memcmp (ml->keywords.exp[mc->kw[h].id],
+                         res->ptr, res->len) == 0)
+            {
+              res->id = mc->kw[h].id;
+              return 0;
+            }
+        }
+      res->id = -1;
+    }
+  else if (ml->keywords.len > 0)
     {
       for (int i=0; i < ml->keywords.len; ++i)
         {
           const char *p = ml->keywords.exp[i];
-          if (strcmp (p, res->cstr) == 0)
+          if (strlen (p) == res->len && memcmp (p, res->ptr, res->len) == 0)
             {
               res->id = i;
               return 0;
@@ -695,6 +1286,123 @@ ml_set_keyword_id (const Milexer *ml, Milexer_Token *res)
   return -1;
 }
 
+/**
+ *  Puts the prefix @pref, which has just been read from @src,
+ *  at the beginning of @tk; in zero-copy mode, it only points
+ *  to @src, unless @pref began in the previous slice
+ */
+static inline void
+__tk_prefix (Milexer_Slice *src, Milexer_Token *tk,
+             bool *zc, const char *pref)
+{
+  size_t len = strlen (pref);
+  if (*zc && src->idx >= len)
+    {
+      tk->ptr = src->buffer + src->idx - len;
+      tk->__idx = len;
+      return;
+    }
+  if (*zc)
+    {
+      *zc = false;
+      tk->__spill = true;
+      tk->ptr = tk->cstr;
+    }
+  *((char *) mempcpy (tk->cstr, pref, len)) = '\0';
+  tk->__idx = len;
+}
+
+/**
+ *  The type of an unfinished token at the end of parsing,
+ *  the remaining of an unterminated expression, or a keyword
+ */
+static inline void
+__tk_last_type (const Milexer *ml, const Milexer_Slice *src,
+                Milexer_Token *tk)
+{
+  enum __buffer_state_t state =
+    (src->state == SYN_ESCAPE) ? src->prev_state : src->state;
+  if (state == SYN_NO_DUMMY)
+    {
+      tk->type = TK_EXPRESSION;
+      tk->id = src->__last_exp_idx;
+    }
+  else
+    {
+      tk->type = TK_KEYWORD;
+      ml_set_keyword_id (ml, tk);
+    }
+}
+
+/**
+ *  Handles fragmentation, when @tk cannot grow anymore
+ *  @return true if the chunk should be passed to the user
+ */
+static inline bool
+__tk_chunk (const Milexer *ml, Milexer_Slice *src,
+            Milexer_Token *tk, int flags)
+{
+  bool keyword = false;
+  /* the state of the escaped byte */
+  enum __buffer_state_t state =
+    (src->state == SYN_ESCAPE) ? src->prev_state : src->state;
+  if ((state == SYN_COMM || state == SYN_ML_COMM)
+      && !HAS_FLAG (flags, PFLAG_INCOMMENT))
+    {
+      TOKEN_FINISH (tk);
+      return false;
+    }
+
+  if (tk->type == TK_NOT_SET ||
+      state == SYN_DUMMY || state == SYN_DONE)
+    {
+      /**
+       *  we assume your keywords are smaller than
+       *  the length of tk->cstr buffer
+       */
+      tk->id = -1;
+      if (state == SYN_COMM || state == SYN_ML_COMM)
+        {
+          tk->type = TK_COMMENT;
+        }
+      else if (state == SYN_NO_DUMMY)
+        {
+          /* the remaining chunks of expressions */
+          tk->type = TK_EXPRESSION;
+          tk->id = src->__last_exp_idx;
+        }
+      else
+        {
+          tk->type = TK_KEYWORD;
+          keyword = true;
+        }
+    }
+  /* max token len reached, keep the escape state as is */
+  if (src->state != SYN_ESCAPE)
+    ST_STATE (src, SYN_CHUNK);
+  TOKEN_FINISH (tk);
+  if (keyword)
+    ml_set_keyword_id (ml, tk);
+  return true;
+}
+
+/**
+ *  In zero-copy mode, moves the unfinished token @tk
+ *  into its buffer, before loading the next slice
+ *  @return false if it does not fit
+ */
+static inline bool
+__tk_spill (Milexer_Token *tk)
+{
+  if (tk->__idx >= tk->cap)
+    return false;
+  memcpy (tk->cstr, tk->ptr, tk->__idx);
+  tk->cstr[tk->__idx] = '\0';
+  tk->ptr = tk->cstr;
+  tk->__spill = true;
+  return true;
+}
+
 int
 ml_next (const Milexer *ml, Milexer_Slice *src,
                    Milexer_Token *tk, int flags)
@@ -702,6 +1410,14 @@ ml_next (const Milexer *ml, Milexer_Slice *src,
   if (tk->cstr == NULL || tk->cap <= 0 || tk->cstr == src->buffer)
     return NEXT_ERR;
 
+  /* zero-copy mode, unless the token spans a load */
+  const bool zc_mode = HAS_FLAG (flags, PFLAG_ZEROCOPY) && ml->__compiled;
+  bool zc = zc_mode && !tk->__spill;
+  /* the previous result was a chunk of the current token */
+  bool chunked = false;
+  if (!zc)
+    tk->ptr = tk->cstr;
+
   /* pre parsing */
   tk->type = TK_NOT_SET;
   switch (src->state)
@@ -711,9 +1427,7 @@ ml_next (const Milexer *ml, Milexer_Slice *src,
         {
           /* certainly the token type is expression */
           tk->type = TK_EXPRESSION;
-          const char *le = __get_last_exp (ml, src)->begin;
-          char *__p = mempcpy (tk->cstr, le, strlen (le));
-          tk->__idx += __p - tk->cstr;
+          __tk_prefix (src, tk, &zc, __get_last_exp (ml, src)->begin);
         }
       src->state = SYN_NO_DUMMY;
       break;
@@ -721,7 +1435,10 @@ ml_next (const Milexer *ml, Milexer_Slice *src,
     case SYN_PUNC__:
       const char *lp = __get_last_punc (ml, src);
       size_t lplen = strlen (lp);
-      memcpy (tk->cstr, lp, lplen);
+      if (zc)
+        tk->ptr = lp;
+      else
+        memcpy (tk->cstr, lp, lplen);
       LD_STATE (src);
       /* just to make to null-terminated */
       tk->__idx = lplen;
@@ -733,15 +1450,14 @@ ml_next (const Milexer *ml, Milexer_Slice *src,
 
     case SYN_CHUNK:
       LD_STATE (src);
+      chunked = true;
       break;
 
     case SYN_ML_COMM:
       if (src->__last_comm && HAS_FLAG (flags, PFLAG_INCOMMENT))
         {
           tk->type = TK_COMMENT;
-          size_t len = strlen (src->__last_comm);
-          *((char *) mempcpy (tk->cstr, src->__last_comm, len)) = 0;
-          tk->__idx = len;
+          __tk_prefix (src, tk, &zc, src->__last_comm);
           src->__last_comm = NULL;
         }
       break;
@@ -753,60 +1469,75 @@ ml_next (const Milexer *ml, Milexer_Slice *src,
   /* check end of src slice */
   if (src->idx >= src->cap)
     {
+      bool end = src->eof_lazy || src->lazy == 0;
+      if (zc && !end && tk->__idx > 0 && !__tk_spill (tk)
+          && __tk_chunk (ml, src, tk, flags))
+        return NEXT_CHUNK;
       src->idx = 0;
+      tk->len = tk->__idx;
       if (tk->__idx == 0)
         {
           *tk->cstr = '\0';
           tk->type = TK_NOT_SET;
         }
-      if (src->eof_lazy || src->lazy == 0)
-        return NEXT_END;
+      if (end)
+        {
+          /**
+           *  the last token, its type was reset after the last load
+           *  it might be empty, when it ends a chunked token
+           */
+          TOKEN_FINISH (tk);
+          if ((tk->len > 0 || chunked) && tk->type == TK_NOT_SET)
+            __tk_last_type (ml, src, tk);
+          return NEXT_END;
+        }
+      if (tk->__idx > 0)
+        tk->__spill = true;
+      else if (chunked)
+        /* the chunked token may go on in the next slice */
+        ST_STATE (src, SYN_CHUNK);
       return NEXT_NEED_LOAD;
     }
 
   /* parsing main logic */
-  const char *p;
-  char *dst = tk->cstr;
+  const char *p, *__ptr;
+  int delims = __ml_delim_mask (ml, flags);
   for (; src->idx < src->cap; )
     {
-      p = src->buffer + (src->idx++);
-      dst = tk->cstr + (tk->__idx++);
-      *dst = *p;
-      
-      //-- detect & reset chunks -------//
-      if (tk->__idx == tk->cap)
+      /* the spilled token has ended, without a result */
+      if (!zc && zc_mode && tk->__idx == 0)
+        zc = true;
+
+      /* skip ahead over the plain bytes of token bodies */
+      if (src->state == SYN_MIDDLE && ml->__compiled && tk->__ac == 0)
         {
-          if ((src->state != SYN_COMM && src->state != SYN_ML_COMM)
-              || HAS_FLAG (flags, PFLAG_INCOMMENT))
+          size_t n = src->cap - src->idx;
+          if (!zc && n > tk->cap - tk->__idx - 1)
+            n = tk->cap - tk->__idx - 1;
+          if ((n = __ml_span (ml->__compiled, delims,
+                              src->buffer + src->idx, n)))
             {
-              if (tk->type == TK_NOT_SET ||
-                  src->state == SYN_DUMMY || src->state == SYN_DONE)
-                {
-                  /**
-                   *  we assume your keywords are smaller than
-                   *  the length of tk->cstr buffer
-                   */
-                  tk->id = -1;
-                  if (src->state == SYN_COMM || src->state == SYN_ML_COMM)
-                    {
-                      tk->type = TK_COMMENT;
-                    }
-                  else
-                    {
-                      tk->type = TK_KEYWORD;
-                      ml_set_keyword_id (ml, tk);
-                    }
-                }
-              /* max token len reached */
-              ST_STATE (src, SYN_CHUNK);
-              TOKEN_FINISH (tk);
-              return NEXT_CHUNK;
+              if (!zc)
+                memcpy (tk->cstr + tk->__idx, src->buffer + src->idx, n);
+              else if (tk->__idx == 0)
+                tk->ptr = src->buffer + src->idx;
+              src->idx += n;
+              tk->__idx += n;
+              if (src->idx >= src->cap)
+                break;
             }
-          else
-            TOKEN_FINISH (tk);
         }
-      //--------------------------------//
-      char *__ptr, c;
+
+      p = src->buffer + (src->idx++);
+      if (!zc)
+        tk->cstr[tk->__idx] = *p;
+      else if (tk->__idx == 0)
+        tk->ptr = p;
+      tk->__idx++;
+      if (ml->__compiled)
+        __ml_step (ml->__compiled, src, tk, *p);
+      
+      int c;
       /* logf ("'%c' - %s, %s", *p,
             milexer_state_cstr[src->state],
             milexer_token_type_cstr[tk->type]); */
@@ -824,12 +1555,13 @@ ml_next (const Milexer *ml, Milexer_Slice *src,
               TOKEN_FINISH (tk);
               if (HAS_FLAG (flags, PFLAG_INCOMMENT))
                 {
-                  *(dst) = '\0';
+                  TOKEN_CUT (tk, zc, tk->len - 1);
                   return NEXT_MATCH;
                 }
               else
                 {
                   *tk->cstr = '\0';
+                  tk->type = TK_NOT_SET;
                 }
             }
           break;
@@ -844,6 +1576,7 @@ ml_next (const Milexer *ml, Milexer_Slice *src,
                   tk->type = TK_COMMENT;
                   return NEXT_MATCH;
                 }
+              tk->type = TK_NOT_SET;
             }
           break;
           
@@ -856,12 +1589,14 @@ ml_next (const Milexer *ml, Milexer_Slice *src,
           else if ((__ptr = __is_mline_commented_pref (ml, src, tk)))
             {
               tk->type = TK_COMMENT;
+              /* the prefix is already in @tk */
+              src->__last_comm = NULL;
               ST_STATE (src, SYN_ML_COMM);
             }
           else if ((__ptr = __is_expression_pref (ml, src, tk)))
             {
               tk->type = TK_EXPRESSION;
-              if (__ptr == tk->cstr)
+              if (__ptr == tk->ptr)
                 {
                   ST_STATE (src, SYN_NO_DUMMY);
                   if (HAS_FLAG (flags, PFLAG_INEXP))
@@ -901,38 +1636,39 @@ ml_next (const Milexer *ml, Milexer_Slice *src,
           if ((__ptr = __is_sline_commented_pref (ml, src, tk)))
             {
               ST_STATE (src, SYN_COMM);
-              if (__ptr == tk->cstr)
+              if (__ptr == tk->ptr)
                 {
                   break;
                 }
               else
                 {
+                  TOKEN_FINISH (tk);
+                  TOKEN_CUT (tk, zc, __ptr - tk->ptr);
                   if (tk->type == TK_NOT_SET)
                     {
                       tk->type = TK_KEYWORD; 
                       ml_set_keyword_id (ml, tk);
                     }
-                  *__ptr = 0;
-                  TOKEN_FINISH (tk);
                   return NEXT_MATCH;
                 }
             }
           else if ((__ptr = __is_mline_commented_pref (ml, src, tk)))
             {
               ST_STATE (src, SYN_ML_COMM);
-              if (__ptr == tk->cstr)
+              if (__ptr == tk->ptr)
                 {
+                  src->__last_comm = NULL;
                   break;
                 }
               else
                 {
+                  TOKEN_FINISH (tk);
+                  TOKEN_CUT (tk, zc, __ptr - tk->ptr);
                   if (tk->type == TK_NOT_SET)
                     {
                       tk->type = TK_KEYWORD; 
                       ml_set_keyword_id (ml, tk);
                     }
-                  *__ptr = 0;
-                  TOKEN_FINISH (tk);
                   return NEXT_MATCH;
                 }
             }
@@ -941,18 +1677,19 @@ ml_next (const Milexer *ml, Milexer_Slice *src,
               if (c == -1)
                 {
                   TOKEN_FINISH (tk);
+                  TOKEN_CUT (tk, zc, tk->len - 1);
                   return NEXT_ZTERM;
                 } 
               if (tk->__idx > 1)
                 {
-                  *dst = '\0';
+                  TOKEN_FINISH (tk);
+                  TOKEN_CUT (tk, zc, tk->len - 1);
                   if (tk->type == TK_NOT_SET)
                     {
                       tk->type = TK_KEYWORD; 
                       ml_set_keyword_id (ml, tk);
                     }
                   ST_STATE (src, SYN_DUMMY);
-                  TOKEN_FINISH (tk);
                   return NEXT_MATCH;
                 }
               else
@@ -972,21 +1709,21 @@ ml_next (const Milexer *ml, Milexer_Slice *src,
                 }
               else
                 {
+                  TOKEN_FINISH (tk);
+                  TOKEN_CUT (tk, zc, tk->len - n);
                   tk->type = TK_KEYWORD;
                   ml_set_keyword_id (ml, tk);
-                  *(dst - n + 1) = '\0';
-                  TOKEN_FINISH (tk);
                   ST_STATE (src, SYN_PUNC__);
                   return NEXT_MATCH;
                 }
             }
           else if ((__ptr = __is_expression_pref (ml, src, tk)))
             {
-              if (__ptr != tk->cstr)
+              if (__ptr != tk->ptr)
                 {
                   ST_STATE (src, SYN_NO_DUMMY__);
-                  *(__ptr) = '\0';
                   TOKEN_FINISH (tk);
+                  TOKEN_CUT (tk, zc, __ptr - tk->ptr);
                   tk->type = TK_KEYWORD;
                   ml_set_keyword_id (ml, tk);
                   return NEXT_MATCH;
@@ -1005,10 +1742,10 @@ ml_next (const Milexer *ml, Milexer_Slice *src,
           if ((__ptr = __is_expression_suff (ml, src, tk)))
             {
               tk->type = TK_EXPRESSION;
+              TOKEN_FINISH (tk);
               if (HAS_FLAG (flags, PFLAG_INEXP))
-                *__ptr = '\0';
+                TOKEN_CUT (tk, zc, __ptr - tk->ptr);
               ST_STATE (src, SYN_DUMMY);
-              TOKEN_FINISH (tk);
               return NEXT_MATCH;
             }
           break;
@@ -1017,41 +1754,544 @@ ml_next (const Milexer *ml, Milexer_Slice *src,
           break;
         }
 
-      /* check for escape */
-      if (*p == '\\')
-        ST_STATE (src, SYN_ESCAPE);
+      /* check for escape */
+      if (*p == '\\')
+        ST_STATE (src, SYN_ESCAPE);
+
+      //-- detect & reset chunks -------//
+      /**
+       *  after handling the byte, otherwise, the suffix of
+       *  an expression (or a delimiter) that fills the buffer
+       *  would be passed over without ending the token
+       */
+      if (!zc && tk->__idx == tk->cap
+          && __tk_chunk (ml, src, tk, flags))
+        return NEXT_CHUNK;
+      //--------------------------------//
+    }
+
+  /* check for end of lazy loading */
+  if (src->eof_lazy || src->lazy == 0)
+    {
+      if (tk->__idx >= 1)
+        {
+          TOKEN_FINISH (tk);
+          if (tk->type == TK_NOT_SET)
+            __tk_last_type (ml, src, tk);
+          return NEXT_END;
+        }
+       else
+        {
+          tk->type = TK_NOT_SET;
+          TOKEN_FINISH (tk);
+          return NEXT_END;
+        }
+    }
+  /* end of src slice */
+  if (zc && tk->__idx > 0 && !__tk_spill (tk)
+      && __tk_chunk (ml, src, tk, flags))
+    return NEXT_CHUNK;
+  src->idx = 0;
+  TOKEN_CUT (tk, zc && !tk->__spill, tk->__idx);
+  if (tk->__idx > 0)
+    tk->__spill = true;
+  if (tk->type == TK_NOT_SET)
+    {
+      tk->type = TK_KEYWORD; 
+      ml_set_keyword_id (ml, tk);
+    }
+  return NEXT_NEED_LOAD;
+}
+
+static inline int
+__ml_feed_flush (Milexer_Feed *f)
+{
+  int ret = 0;
+  if (f->__n > 0)
+    ret = f->emit (f->__res, f->__n, f->arg);
+  f->__n = f->__tlen = 0;
+  return ret;
+}
+
+static inline int
+__ml_feed_keep (Milexer_Feed *f, int ret, const char *buf, size_t len)
+{
+  const Milexer_Token *tk = &f->__tk;
+  const char *ptr = tk->ptr;
+  /* copied or spilled results, @tk will be overwritten */
+  bool copy = tk->len > 0 && (!buf || ptr < buf || ptr >= buf + len);
+  int err;
+
+  if (f->__n == ML_FEED_BATCH
+      || (copy && f->__tcap - f->__tlen < tk->len))
+    if ((err = __ml_feed_flush (f)) != 0)
+      return err;
+  if (copy)
+    {
+      ptr = memcpy (f->__text + f->__tlen, tk->ptr, tk->len);
+      f->__tlen += tk->len;
+    }
+  f->__res[f->__n++] = (Milexer_Result){
+    .ret = ret, .type = tk->type, .id = tk->id,
+    .ptr = ptr, .len = tk->len,
+  };
+  return 0;
+}
+
+int
+ml_feed (const Milexer *ml, Milexer_Feed *f,
+         const char *buf, size_t len)
+{
+  int ret = 0;
+  if (!f->__res)
+    {
+      if (!buf)
+        return 0;
+      /* the results, their copies and the token buffer */
+      size_t tcap = f->tk_cap > 4096 ? f->tk_cap : 4096;
+      char *mem = ml_alloc (ML_FEED_BATCH * sizeof (Milexer_Result)
+                            + tcap + f->tk_cap + 1);
+      if (!mem)
+        return -1;
+      f->__res = (Milexer_Result *) mem;
+      f->__text = mem + ML_FEED_BATCH * sizeof (Milexer_Result);
+      f->__n = f->__tlen = 0;
+      f->__tcap = tcap;
+      f->__src = (Milexer_Slice){.lazy = true};
+      f->__tk = (Milexer_Token){
+        .cstr = f->__text + tcap, .cap = f->tk_cap,
+      };
+    }
+
+  if (buf)
+    SET_ML_SLICE (&f->__src, buf, len);
+  else
+    END_ML_SLICE (&f->__src);
+  for (int r = 0; ret == 0 && r != NEXT_NEED_LOAD && !NEXT_SHOULD_END (r); )
+    {
+      r = ml_next (ml, &f->__src, &f->__tk, f->flags);
+      switch (r)
+        {
+        case NEXT_END:
+          if (f->__tk.len == 0 && f->__tk.type == TK_NOT_SET)
+            break;
+          /* the last token */
+          __attribute__((fallthrough));
+        case NEXT_MATCH:
+        case NEXT_CHUNK:
+        case NEXT_ZTERM:
+          ret = __ml_feed_keep (f, r, buf, len);
+          break;
+
+        case NEXT_ERR:
+          ret = -1;
+          break;
+
+        default: break;
+        }
+    }
+  /* results in @buf are only valid in this call */
+  if (ret == 0)
+    ret = __ml_feed_flush (f);
+
+  if (!buf)
+    {
+      ml_free (f->__res);
+      f->__res = NULL;
+    }
+  return ret;
+}
+
+#ifdef ML_PARALLEL
+#include <pthread.h>
+
+/* text of the results that are not in the input, see __ml_keep */
+struct ml_text_t
+{
+  struct ml_text_t *next;
+  size_t len, cap;
+  char data[];
+};
+
+/* the input offset after each result, see __ml_chunk_relex */
+struct ml_mark_t
+{
+  size_t pos;
+  bool clean;
+};
+
+/* a chunk of the input of ml_parallel, and its results */
+struct ml_chunk_t
+{
+  const Milexer *ml;
+  const Milexer_Parallel *opt;
+  const char *buf, *end; /* the whole input */
+  const char *beg, *lim; /* this chunk */
+  bool last;
+
+  /* the parser state at the end of the chunk */
+  Milexer_Slice src;
+  Milexer_Token tk;
+
+  Milexer_Result *res;
+  struct ml_mark_t *marks;
+  size_t nres, cap;
+  struct ml_text_t *text;
+  int err;
+};
+
+/**
+ *  Whether the parser can resume after @c from the initial state
+ *  i.e. the chunk has not ended within a token
+ */
+#define __ml_clean(src, tk) \
+  ((src)->state == SYN_DUMMY && (tk)->__idx == 0 && (tk)->__ac == 0)
+#define __ml_chunk_clean(c) __ml_clean (&(c)->src, &(c)->tk)
+
+/**
+ *  The beginning of the next chunk, after a delimiter
+ *  New lines within @n bytes are preferred, as tokens
+ *  like strings are less likely to span them
+ */
+static inline const char *
+__ml_split (const Milexer *ml, int flags,
+            const char *p, size_t n, const char *end)
+{
+  const char *nl;
+  if ((size_t)(end - p) < n)
+    n = end - p;
+  if (__detect_delim (ml, '\n', flags) > 0
+      && !(ml->__compiled && ml->__compiled->cls['\n'] & MLC_SPECIAL)
+      && (nl = memchr (p, '\n', n)))
+    return nl + 1;
+  for (; p < end; ++p)
+    {
+      unsigned char c = *p;
+      if (__detect_delim (ml, c, flags) > 0
+          && !(ml->__compiled && ml->__compiled->cls[c] & MLC_SPECIAL))
+        return p + 1;
+    }
+  return end;
+}
+
+static inline void
+__ml_chunk_reset (struct ml_chunk_t *c)
+{
+  for (struct ml_text_t *t = c->text, *next; t; t = next)
+    {
+      next = t->next;
+      ml_free (t);
+    }
+  c->text = NULL;
+  c->nres = 0;
+  c->err = 0;
+}
+
+static inline void
+__ml_chunk_free (struct ml_chunk_t *c)
+{
+  __ml_chunk_reset (c);
+  if (c->res)
+    ml_free (c->res);
+  if (c->marks)
+    ml_free (c->marks);
+  c->res = NULL, c->marks = NULL;
+  c->cap = 0;
+}
+
+/* to make room for at least @n results in @c */
+static inline int
+__ml_reserve (struct ml_chunk_t *c, size_t n)
+{
+  if (n <= c->cap)
+    return 0;
+  size_t cap = c->cap ? 2 * c->cap : 1024;
+  while (cap < n)
+    cap *= 2;
+  Milexer_Result *res = ml_alloc (cap * sizeof (*res));
+  struct ml_mark_t *marks = ml_alloc (cap * sizeof (*marks));
+  if (!res || !marks)
+    {
+      if (res)
+        ml_free (res);
+      if (marks)
+        ml_free (marks);
+      return -1;
+    }
+  if (c->res)
+    {
+      memcpy (res, c->res, c->nres * sizeof (*res));
+      memcpy (marks, c->marks, c->nres * sizeof (*marks));
+      ml_free (c->res);
+      ml_free (c->marks);
+    }
+  c->res = res, c->marks = marks;
+  c->cap = cap;
+  return 0;
+}
+
+/* appends the current result of @c, @ret of ml_next */
+static inline int
+__ml_keep (struct ml_chunk_t *c, int ret)
+{
+  const Milexer_Token *tk = &c->tk;
+  if (__ml_reserve (c, c->nres + 1))
+    return -1;
+
+  const char *ptr = tk->ptr;
+  if (tk->len > 0 && (ptr < c->buf || ptr >= c->end))
+    {
+      /* copied or spilled results, @tk will be overwritten */
+      struct ml_text_t *t = c->text;
+      if (!t || t->cap - t->len < tk->len)
+        {
+          size_t cap = tk->len > 4096 ? tk->len : 4096;
+          if (!(t = ml_alloc (sizeof (*t) + cap)))
+            return -1;
+          *t = (struct ml_text_t){.next = c->text, .cap = cap};
+          c->text = t;
+        }
+      ptr = memcpy (t->data + t->len, tk->ptr, tk->len);
+      t->len += tk->len;
+    }
+  c->res[c->nres] = (Milexer_Result){
+    .ret = ret, .type = tk->type, .id = tk->id,
+    .ptr = ptr, .len = tk->len,
+  };
+  c->marks[c->nres++] = (struct ml_mark_t){
+    .pos = c->src.idx, .clean = __ml_clean (&c->src, tk),
+  };
+  return 0;
+}
+
+/**
+ *  Lexes @c, from the current state of @c->src and @c->tk
+ *  and stops when it gets in sync with the results @sync
+ *  @return 0, or n when in sync after @sync[n - 1]
+ */
+static size_t
+__ml_chunk_lex__H (struct ml_chunk_t *c,
+                   const struct ml_mark_t *sync, size_t nsync)
+{
+  size_t k = 0;
+  SET_ML_SLICE (&c->src, c->beg, (size_t)(c->lim - c->beg));
+  for (int ret = 0; !NEXT_SHOULD_END (ret); )
+    {
+      ret = ml_next (c->ml, &c->src, &c->tk, c->opt->flags);
+      switch (ret)
+        {
+        case NEXT_NEED_LOAD:
+          if (!c->last)
+            return 0;
+          END_ML_SLICE (&c->src);
+          break;
+
+        case NEXT_END:
+          if (c->tk.len == 0 && c->tk.type == TK_NOT_SET)
+            break;
+          /* the last token */
+          __attribute__((fallthrough));
+        case NEXT_MATCH:
+        case NEXT_CHUNK:
+        case NEXT_ZTERM:
+          if (__ml_keep (c, ret))
+            {
+              c->err = -1;
+              return 0;
+            }
+          /* the same position and state as @sync[k] */
+          if (nsync > 0 && c->marks[c->nres - 1].clean)
+            {
+              size_t pos = c->marks[c->nres - 1].pos;
+              for (; k < nsync && sync[k].pos < pos; ++k)
+                ;
+              for (size_t j = k; j < nsync && sync[j].pos == pos; ++j)
+                if (sync[j].clean && (j + 1 == nsync
+                                      || sync[j + 1].pos != pos))
+                  return j + 1;
+            }
+          break;
+
+        case NEXT_ERR:
+          c->err = -1;
+          break;
+
+        default: break;
+        }
+    }
+  return 0;
+}
+
+static void *
+__ml_chunk_lex (void *arg)
+{
+  __ml_chunk_lex__H (arg, NULL, 0);
+  return NULL;
+}
+
+/**
+ *  Lexes @c again, from the end state of the previous chunk @b
+ *  As soon as the parser reaches a clean state, at the same
+ *  position as the first (speculative) pass, the remaining
+ *  results of the first pass are kept, as they would be the same
+ */
+static void
+__ml_chunk_relex (struct ml_chunk_t *c, struct ml_chunk_t *b)
+{
+  /* the first pass */
+  Milexer_Result *res = c->res;
+  struct ml_mark_t *marks = c->marks;
+  size_t nres = c->nres;
+  Milexer_Slice src = c->src;
+  Milexer_Token tk = c->tk;
+
+  c->res = NULL, c->marks = NULL;
+  c->nres = c->cap = 0;
+  c->src = b->src;
+  c->tk = b->tk;
+  size_t j = __ml_chunk_lex__H (c, marks, nres);
+  if (j > 0)
+    {
+      /* in sync, keep the rest of the first pass and its end state */
+      if (__ml_reserve (c, c->nres + nres - j))
+        c->err = -1;
+      else
+        {
+          memcpy (c->res + c->nres, res + j, (nres - j) * sizeof (*res));
+          memcpy (c->marks + c->nres, marks + j,
+                  (nres - j) * sizeof (*marks));
+          c->nres += nres - j;
+        }
+      b->tk.cstr = c->tk.cstr;
+      c->src = src;
+      c->tk = tk;
+    }
+  else
+    b->tk.cstr = tk.cstr;
+  if (res)
+    ml_free (res);
+  if (marks)
+    ml_free (marks);
+}
+
+static void *
+__ml_chunk_emit (void *arg)
+{
+  struct ml_chunk_t *c = arg;
+  c->err = c->opt->emit (c->res, c->nres, c->opt->arg);
+  return NULL;
+}
+
+/* runs @fn on @n chunks @cs, using threads @th */
+static inline void
+__ml_chunk_run (void *(*fn) (void *), struct ml_chunk_t *cs,
+                pthread_t *th, int n)
+{
+  bool *started = (bool *)(th + n);
+  for (int i=0; i < n; ++i)
+    started[i] = pthread_create (th + i, NULL, fn, cs + i) == 0;
+  for (int i=0; i < n; ++i)
+    {
+      if (started[i])
+        pthread_join (th[i], NULL);
+      else
+        fn (cs + i);
+    }
+}
+
+int
+ml_parallel (const Milexer *ml, const char *buf, size_t len,
+             const Milexer_Parallel *opt)
+{
+  int n = opt->nthreads > 0 ? opt->nthreads : 1;
+  size_t chunk = opt->chunk > 0 ? opt->chunk : ML_PARALLEL_CHUNK;
+  /* @n chunks and the last chunk of the previous round */
+  struct ml_chunk_t *cs = ml_alloc ((n + 1) * sizeof (*cs));
+  pthread_t *th = ml_alloc (n * (sizeof (*th) + sizeof (bool)));
+  int ret = 0;
+  /* before any failure, the cleanup frees the buffers of @cs */
+  if (cs)
+    memset (cs, 0, (n + 1) * sizeof (*cs));
+  if (!cs || !th)
+    {
+      ret = -1;
+      goto eo_parallel;
+    }
+  for (int i=0; i <= n; ++i)
+    {
+      cs[i].ml = ml, cs[i].opt = opt;
+      cs[i].buf = buf, cs[i].end = buf + len;
+      cs[i].tk = (Milexer_Token){.cstr = ml_alloc (opt->tk_cap + 1),
+                                 .cap = opt->tk_cap};
+      if (!cs[i].tk.cstr)
+        ret = -1;
     }
 
-  /* check for end of lazy loading */
-  if (src->eof_lazy || src->lazy == 0)
+  struct ml_chunk_t *prev = NULL;
+  for (const char *p = buf; ret == 0 && p < buf + len; )
     {
-      if (tk->__idx >= 1)
+      int k;
+      for (k = 0; k < n && p < buf + len; ++k)
         {
-          if (tk->type == TK_NOT_SET)
-            {
-              tk->type = TK_KEYWORD;
-              ml_set_keyword_id (ml, tk);
-            }
-          TOKEN_FINISH (tk);
-          return NEXT_END;
+          struct ml_chunk_t *c = cs + k;
+          c->beg = p;
+          p = (size_t)(buf + len - p) > chunk ? p + chunk : buf + len;
+          c->lim = p = __ml_split (ml, opt->flags, p, chunk, buf + len);
+          c->last = (p == buf + len);
+          __ml_chunk_reset (c);
+          c->src = (Milexer_Slice){.lazy = true};
+          c->tk = (Milexer_Token){.cstr = c->tk.cstr, .cap = c->tk.cap};
         }
-       else
+      __ml_chunk_run (__ml_chunk_lex, cs, th, k);
+
+      /* fix-up, in the input order */
+      for (int i=0; i < k; ++i)
         {
-          tk->type = TK_NOT_SET;
-          TOKEN_FINISH (tk);
-          return NEXT_END;
+          struct ml_chunk_t *b = (i == 0) ? prev : cs + i - 1;
+          struct ml_chunk_t *c = cs + i;
+          if (b && !__ml_chunk_clean (b))
+            __ml_chunk_relex (c, b);
+          if (c->err)
+            ret = -1;
         }
+      if (ret != 0)
+        break;
+
+      if (opt->ordered)
+        {
+          for (int i=0; i < k && ret == 0; ++i)
+            ret = opt->emit (cs[i].res, cs[i].nres, opt->arg);
+        }
+      else
+        {
+          __ml_chunk_run (__ml_chunk_emit, cs, th, k);
+          for (int i=0; i < k && ret == 0; ++i)
+            ret = cs[i].err;
+        }
+
+      /* keep the last chunk, for the next round */
+      struct ml_chunk_t tmp = cs[n];
+      cs[n] = cs[k - 1];
+      cs[k - 1] = tmp;
+      prev = cs + n;
     }
-  /* end of src slice */
-  src->idx = 0;
-  *(dst + 1) = '\0';
-  if (tk->type == TK_NOT_SET)
+
+ eo_parallel:
+  if (cs)
     {
-      tk->type = TK_KEYWORD; 
-      ml_set_keyword_id (ml, tk);
+      for (int i=0; i <= n; ++i)
+        {
+          __ml_chunk_free (cs + i);
+          if (cs[i].tk.cstr)
+            ml_free (cs[i].tk.cstr);
+        }
+      ml_free (cs);
     }
-  return NEXT_NEED_LOAD;
+  if (th)
+    ml_free (th);
+  return ret;
 }
+#endif /* ML_PARALLEL */
 
 #endif /* ML_IMPLEMENTATION */
 
@@ -1065,7 +2305,7 @@ ml_next (const Milexer *ml, Milexer_Slice *src,
  **  Common headers for both
  **  example_1 and test_1 programs
  **/
-#if defined (ML_EXAMPLE_1) || defined (ML_TEST_1)
+#if defined (ML_EXAMPLE_1) || defined (ML_TEST_1) || defined (ML_BENCH)
 # include <stdio.h>
 # include <stdlib.h>
 # include <stdbool.h>
@@ -1134,7 +2374,7 @@ static Milexer ml = {
     .a_comment   = GEN_MKCFG (ML_Comments),
   };
 //--------------------------------------//
-#endif /* defined (ML_EXAMPLE_1) || defined (ML_TEST_1) */
+#endif /* defined (ML_EXAMPLE_1) || defined (ML_TEST_1) || ... */
 
 
 
@@ -1290,6 +2530,7 @@ typedef struct
   int parsing_flags;
   char *input;
   const Milexer_Token* etk; /* expected tokens */
+  bool ids; /* also compare IDs of the keywords */
 } test_t;
 
 
@@ -1321,17 +2562,29 @@ do_test__H (test_t *t, Milexer_Slice *src)
       printf (" test %d:%d: expect `%s`... ", t->test_number, counter, tcase->cstr);
 #endif
 
-      if (strcmp (tcase->cstr, tk.cstr) != 0)
+      if (!HAS_FLAG (t->parsing_flags, PFLAG_ZEROCOPY)
+          && strcmp (tcase->cstr, tk.cstr) != 0)
         {
           Return (counter, "token `%s` != expected `%s`",
                   tk.cstr, tcase->cstr);
         }
+      if (strlen (tcase->cstr) != tk.len
+          || strncmp (tcase->cstr, tk.ptr, tk.len) != 0)
+        {
+          Return (counter, "token `%.*s` != expected `%s`",
+                  (int) tk.len, tk.ptr, tcase->cstr);
+        }
       if (tcase->type != TK_NOT_SET && tcase->type != tk.type)
         {
           Return (counter, "token type `%s` != expected `%s`",
                   milexer_token_type_cstr[tk.type],
                   milexer_token_type_cstr[tcase->type]);
         }
+      if (t->ids && tk.type == TK_KEYWORD && tcase->id != tk.id)
+        {
+          Return (counter, "keyword ID %d != expected %d",
+                  tk.id, tcase->id);
+        }
       if (ret == NEXT_NEED_LOAD && src->eof_lazy)
         {
           Return (counter, "unexpected NEXT_NEED_LOAD");
@@ -1363,17 +2616,167 @@ do_test (test_t *t, const char *msg, Milexer_Slice *src)
   return -1;
 }
 
+#ifdef ML_PARALLEL
+#  include <pthread.h>
+#endif
+
+/* results of ml_feed and ml_parallel, as text */
+struct results_t
+{
+  char buf[8192];
+  size_t len, n;
+#ifdef ML_PARALLEL
+  pthread_mutex_t lock;
+#endif
+};
+
+static int
+results_emit (const Milexer_Result *res, size_t n, void *arg)
+{
+  struct results_t *out = arg;
+#ifdef ML_PARALLEL
+  pthread_mutex_lock (&out->lock);
+#endif
+  for (size_t i=0; i < n; ++i, ++out->n)
+    {
+      if (out->len < sizeof (out->buf))
+        out->len += snprintf (out->buf + out->len,
+                              sizeof (out->buf) - out->len,
+                              "%d:%d:%d:%.*s\n", res[i].ret, res[i].type,
+                              res[i].type == TK_COMMENT ? 0 : res[i].id,
+                              (int) res[i].len, res[i].ptr);
+    }
+#ifdef ML_PARALLEL
+  pthread_mutex_unlock (&out->lock);
+#endif
+  return 0;
+}
+
+static const char *results_input =
+  "if x != y (a b) \"str ing\" else # comm ent\n"
+  "long_token_longer_than_16_bytes z=1,2 /* multi line\n"
+  " comment */ 'q' <<long exp>> fi\\ a-b*c {x\ny} end";
+
+/* the reference results of @results_input, by ml_next */
+static void
+results_ref (int flags, size_t tk_cap, struct results_t *out)
+{
+  Milexer_Slice src = {.lazy = true};
+  Milexer_Token t = TOKEN_ALLOC (tk_cap);
+  out->len = out->n = 0;
+  for (int ret = 0; !NEXT_SHOULD_END (ret); )
+    {
+      ret = ml_next (&ml, &src, &t, flags);
+      if (ret == NEXT_NEED_LOAD)
+        {
+          if (src.buffer == results_input)
+            END_ML_SLICE (&src);
+          else
+            SET_ML_SLICE (&src, results_input, strlen (results_input));
+        }
+      else if (ret != NEXT_ERR && (ret != NEXT_END || t.len > 0))
+        {
+          Milexer_Result r = {ret, t.type, t.id, t.ptr, t.len};
+          results_emit (&r, 1, out);
+        }
+    }
+  TOKEN_FREE (&t);
+}
+
+/* compares ml_feed with ml_next, feeding slices of different lengths */
+int
+test_feed (int test_number, int flags)
+{
+  static struct results_t expected, out;
+  const size_t len = strlen (results_input);
+  /**
+   *  zero-copy tokens that span loads are fragmented differently,
+   *  unless they fit in the token buffer
+   */
+  const size_t tk_cap = HAS_FLAG (flags, PFLAG_ZEROCOPY) ? 64 : 16;
+  printf ("Test #%d: feeding, flags %d... ", test_number, flags);
+
+  results_ref (flags, tk_cap, &expected);
+  for (size_t n = 1; n <= len; n = (n < 48) ? n + 1 : n + len)
+    {
+      Milexer_Feed f = {
+        .flags = flags, .tk_cap = tk_cap,
+        .emit = results_emit, .arg = &out,
+      };
+      out.len = out.n = 0;
+      for (size_t i = 0; i < len; i += n)
+        if (ml_feed (&ml, &f, results_input + i,
+                     (len - i < n) ? len - i : n) != 0)
+          break;
+      if (ml_feed (&ml, &f, NULL, 0) != 0
+          || out.len != expected.len
+          || memcmp (out.buf, expected.buf, out.len) != 0)
+        {
+          printf ("fail!\n slices of %zu bytes\n", n);
+          return test_number;
+        }
+    }
+  puts ("pass");
+  return -1;
+}
+
+#ifdef ML_PARALLEL
+/* compares ml_parallel with ml_next, using different chunk sizes */
 int
-main (void)
+test_parallel (int test_number, int flags)
+{
+  static struct results_t expected, out;
+  const size_t len = strlen (results_input);
+  printf ("Test #%d: parallel lexing, flags %d... ", test_number, flags);
+
+  results_ref (flags, 16, &expected);
+  Milexer_Parallel opt = {
+    .flags = flags, .tk_cap = 16,
+    .ordered = true, .emit = results_emit, .arg = &out,
+  };
+  for (opt.chunk = 1; opt.chunk < 48; ++opt.chunk)
+    for (opt.nthreads = 1; opt.nthreads <= 4; opt.nthreads += 3)
+      {
+        out.len = out.n = 0;
+        if (ml_parallel (&ml, results_input, len, &opt) != 0
+            || out.len != expected.len
+            || memcmp (out.buf, expected.buf, out.len) != 0)
+          {
+            printf ("fail!\n chunk %zu, %d threads\n",
+                    opt.chunk, opt.nthreads);
+            return test_number;
+          }
+      }
+
+  /* unordered, only the number of results */
+  out.len = out.n = 0;
+  opt.ordered = false;
+  opt.chunk = 7;
+  if (ml_parallel (&ml, results_input, len, &opt) != 0
+      || out.n != expected.n)
+    {
+      printf ("fail!\n unordered: %zu != %zu results\n",
+              out.n, expected.n);
+      return test_number;
+    }
+  puts ("pass");
+  return -1;
+}
+#endif /* ML_PARALLEL */
+
+/* runs all the tests, using the current state of @ml */
+int
+run_tests (void)
 {
-  static Milexer_Slice src = {.lazy = 1};
+  static Milexer_Slice src;
 #define DO_TEST(test, msg)                         \
   if (do_test (test, msg, &src) != -1)             \
-    { ret = 1; goto eo_main; }
+    { ret = 1; goto eo_tests; }
 
   test_t t = {0};
   int ret = 0;
-  tk = TOKEN_ALLOC (16);
+  src = (Milexer_Slice){.lazy = 1};
+  TOKEN_DROP (&tk);
 
   puts ("-- elementary tests -- ");
   {
@@ -1570,6 +2973,8 @@ main (void)
     /* making `.`,`@` and `0`,...,`9` delimiters */
     const char *delims[] = {".", "09", "@"};
     ml.delim_ranges = (Milexer_BEXP)GEN_MKCFG (delims);
+    if (ml.__compiled)
+      ml_compile (&ml);
     {
       t = (test_t) {
         .test_number = 15,
@@ -1600,6 +3005,8 @@ main (void)
     }
     /* unset the custom delimiters */
     ml.delim_ranges = (Milexer_BEXP){0};
+    if (ml.__compiled)
+      ml_compile (&ml);
   }
 
   puts ("-- escape --");
@@ -1730,24 +3137,452 @@ main (void)
       }};
     DO_TEST (&t, "with include comment flag");
   }
-  
+
+  puts ("-- keywords --");
+  {
+    t = (test_t) {
+      .test_number = 27,
+      .parsing_flags = PFLAG_DEFAULT,
+      .input = "fi iff else if elsee ",
+      .ids = true,
+      .etk = (Milexer_Token []){
+        {.type = TK_KEYWORD, .cstr = "fi",    .id = LANG_FI},
+        {.type = TK_KEYWORD, .cstr = "iff",   .id = -1},
+        {.type = TK_KEYWORD, .cstr = "else",  .id = LANG_ELSE},
+        {.type = TK_KEYWORD, .cstr = "if",    .id = LANG_IF},
+        {.type = TK_KEYWORD, .cstr = "elsee", .id = -1},
+        {0}
+      }};
+    DO_TEST (&t, "keyword IDs");
+  }
+
+  if (ml.__compiled)
+    {
+      puts ("-- zero-copy --");
+      t = (test_t) {
+        .test_number = 28,
+        .parsing_flags = PFLAG_ZEROCOPY,
+        .input = "a_keyword_longer_than_16 (e x p)x!=y ",
+        .etk = (Milexer_Token []){
+          {.type = TK_KEYWORD,    .cstr = "a_keyword_longer_than_16"},
+          {.type = TK_EXPRESSION, .cstr = "(e x p)"},
+          {.type = TK_KEYWORD,    .cstr = "x"},
+          {.type = TK_PUNCS,      .cstr = "!="},
+          {.type = TK_KEYWORD,    .cstr = "y"},
+          {0}
+        }};
+      DO_TEST (&t, "basic zero-copy");
+
+      t = (test_t) {
+        .test_number = 29,
+        .parsing_flags = PFLAG_ZEROCOPY,
+        .input = "spans_a_lo",
+        .etk = (Milexer_Token []){
+          {.type = TK_KEYWORD,    .cstr = "spans_a_lo"},
+          {0}
+        }};
+      DO_TEST (&t, "before load");
+
+      t = (test_t) {
+        .test_number = 30,
+        .parsing_flags = PFLAG_ZEROCOPY,
+        .input = "ad boundary ",
+        .etk = (Milexer_Token []){
+          {.type = TK_KEYWORD,    .cstr = "spans_a_load"},
+          {.type = TK_KEYWORD,    .cstr = "boundary"},
+          {0}
+        }};
+      DO_TEST (&t, "spilled after load");
+
+      t = (test_t) {
+        .test_number = 31,
+        .parsing_flags = PFLAG_ZEROCOPY,
+        .input = "0123456789abcdefghij",
+        .etk = (Milexer_Token []){
+          {.type = TK_KEYWORD,    .cstr = "0123456789abcdefghij"},
+          {.type = TK_NOT_SET,    .cstr = ""}, // load
+          {0}
+        }};
+      DO_TEST (&t, "long token before load");
+
+      t = (test_t) {
+        .test_number = 32,
+        .parsing_flags = PFLAG_ZEROCOPY,
+        .input = "klm ",
+        .etk = (Milexer_Token []){
+          {.type = TK_KEYWORD,    .cstr = "klm"},
+          {0}
+        }};
+      DO_TEST (&t, "the remaining chunk");
+    }
+
+  /* the flags of feeding and parallel tests */
+  const int feed_flags[] = {
+    PFLAG_DEFAULT, PFLAG_INEXP | PFLAG_INCOMMENT, PFLAG_ZEROCOPY,
+  };
+#ifdef ML_PARALLEL
+  puts ("-- parallel --");
+  for (size_t i=0; i < GEN_LENOF (feed_flags); ++i)
+    if (test_parallel (33 + i, feed_flags[i]) != -1)
+      { ret = 1; goto eo_tests; }
+#endif /* ML_PARALLEL */
 
   puts ("-- end of input slice --");
   {
+    t = (test_t) {
+      .test_number = 36,
+      .parsing_flags = PFLAG_DEFAULT,
+      .input = "x (unterminated",
+      .etk = (Milexer_Token []){
+        {.type = TK_KEYWORD,    .cstr = "x"},
+        {.type = TK_NOT_SET,    .cstr = "(unterminated"}, // load
+        {0}
+      }};
+    DO_TEST (&t, "before the end");
+
     END_ML_SLICE (&src);
     t = (test_t) {
       .test_number = 0,
       .parsing_flags = PFLAG_DEFAULT,
       .input = "",
       .etk = (Milexer_Token []){
+        {.type = TK_EXPRESSION, .cstr = "(unterminated"},
         {0}
       }};
     DO_TEST (&t, "end of lazy loading");
   }
 
+  puts ("-- feeding --");
+  for (size_t i=0; i < GEN_LENOF (feed_flags); ++i)
+    if (test_feed (37 + i, feed_flags[i]) != -1)
+      { ret = 1; goto eo_tests; }
+
   puts ("\n *** All tests were passed *** ");
+ eo_tests:
+  return ret;
+}
+
+int
+main (void)
+{
+  int ret;
+  tk = TOKEN_ALLOC (16);
+
+  puts ("==== interpreted configuration ====");
+  if ((ret = run_tests ()) != 0)
+    goto eo_main;
+
+  puts ("\n==== compiled configuration ====");
+  if (ml_compile (&ml) != 0)
+    {
+      puts ("ml_compile failed");
+      ret = 1;
+      goto eo_main;
+    }
+  ret = run_tests ();
+  ml_uncompile (&ml);
+
  eo_main:
   TOKEN_FREE (&tk);
   return ret;
 }
 #endif /* ML_TEST_1 */
+
+
+
+/**
+ **  The benchmark program
+ **/
+#ifdef ML_BENCH
+# include <time.h>
+
+#ifndef BENCH_SIZE
+# define BENCH_SIZE (4 * 1024 * 1024)
+#endif
+#ifndef BENCH_LOAD
+# define BENCH_LOAD 4096 /* length of slices in lazy loading */
+#endif
+
+/* word tokens, like key_extractor */
+static const char *Word_Delims[] = {"\x01/", ":@", "[^", "`", "{\x7f"};
+static Milexer ml_words = {.delim_ranges = GEN_MKCFG (Word_Delims)};
+
+static const struct
+{
+  const char *name;
+  Milexer *ml;
+  bool compiled;
+  int flags;
+} Configs[] = {
+  {"lang",    &ml, false, PFLAG_DEFAULT},
+  {"lang+c",  &ml, true,  PFLAG_DEFAULT},
+  {"lang+zc", &ml, true,  PFLAG_ZEROCOPY},
+  {"inexp+c", &ml, true,  PFLAG_INEXP | PFLAG_INCOMMENT},
+  {"words+c", &ml_words, true, PFLAG_DEFAULT},
+};
+static const size_t Token_Caps[] = {16, 64, 1024};
+
+//-- Generated corpora -----------------//
+static unsigned long long rnd_state;
+
+static inline unsigned int
+rnd (unsigned int n)
+{
+  /* xorshift64, to be the same on every platform */
+  rnd_state ^= rnd_state << 13;
+  rnd_state ^= rnd_state >> 7;
+  rnd_state ^= rnd_state << 17;
+  return (unsigned int)(rnd_state >> 32) % n;
+}
+
+#define RND_OF(arr) arr[rnd (sizeof (arr) / sizeof (*arr))]
+
+static const char *Src_Words[] = {
+  "if", "else", "fi", "foo", "bar_baz", "x1", "count", "12", "0x1f",
+  "+", "-", "*", ",", "=", "!=", "(a, b)", "{x = y}", "'c'",
+  "\"str \\\"esc\\\" ing\"", "<<long exp>>", "é", "a_very_long_identifier",
+};
+static const char *Src_Seps[] = {
+  " ", " ", " ", "  ", "\n", "\n  ", "\n\t", "\n\n", "",
+  " # comment\n", " // line comment\n", " /* multi\n  line */ ",
+};
+
+static size_t
+gen_source (char *buf, size_t n)
+{
+  size_t len = 0, l;
+  const char *s;
+  for (int i = 0; len < n; ++i)
+    {
+      s = (i & 1) ? RND_OF (Src_Seps) : RND_OF (Src_Words);
+      if ((l = strlen (s)) > n - len)
+        l = n - len;
+      memcpy (buf + len, s, l);
+      len += l;
+    }
+  return len;
+}
+
+static const char *Log_Levels[] = {"INFO", "INFO", "WARN", "DEBUG", "ERROR"};
+static const char *Log_Msgs[] = {
+  "request done", "cache miss", "retry (attempt 2)",
+  "user 'guest' logged in", "connection reset by peer",
+};
+
+static size_t
+gen_logs (char *buf, size_t n)
+{
+  size_t len = 0;
+  char line[256];
+  while (len < n)
+    {
+      int l = snprintf (line, sizeof (line),
+                        "2024-%02u-%02u %02u:%02u:%02u.%03u [%s] worker-%u: "
+                        "%s id=0x%04x path=\"/api/v%u/items/%u\" took %ums\n",
+                        1 + rnd (12), 1 + rnd (28), rnd (24), rnd (60),
+                        rnd (60), rnd (1000), RND_OF (Log_Levels), rnd (16),
+                        RND_OF (Log_Msgs), rnd (0x10000), 1 + rnd (3),
+                        rnd (100000), rnd (5000));
+      if ((size_t)l > n - len)
+        l = n - len;
+      memcpy (buf + len, line, l);
+      len += l;
+    }
+  return len;
+}
+
+static size_t
+gen_noise (char *buf, size_t n)
+{
+  for (size_t i = 0; i < n; ++i)
+    buf[i] = rnd (256);
+  return n;
+}
+
+static const struct
+{
+  const char *name;
+  size_t (*gen) (char *buf, size_t n);
+} Corpora[] = {
+  {"source", gen_source},
+  {"logs", gen_logs},
+  {"noise", gen_noise},
+};
+
+//-- Benchmark -------------------------//
+struct bench_t
+{
+  size_t tokens;
+  unsigned int hash;
+  double sec;
+};
+
+static inline double
+now (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* FNV-1a, continues from @h */
+static inline unsigned int
+bench_hash (unsigned int h, const void *p, size_t len)
+{
+  for (const unsigned char *c = p; len > 0; --len, ++c)
+    h = (h ^ *c) * 0x01000193;
+  return h;
+}
+
+static void
+bench_run (const Milexer *ml, int flags, Milexer_Token *tk,
+           const char *buf, size_t len, bool lazy, struct bench_t *b)
+{
+  size_t off = 0, n;
+  Milexer_Slice src = {.lazy = lazy};
+  unsigned int h = 0x811c9dc5;
+
+  b->tokens = 0;
+  if (!lazy)
+    SET_ML_SLICE (&src, buf, len);
+  b->sec = now ();
+  for (int ret = 0; !NEXT_SHOULD_END (ret); )
+    {
+      ret = ml_next (ml, &src, tk, flags);
+      switch (ret)
+        {
+        case NEXT_NEED_LOAD:
+          if (off < len)
+            {
+              n = (len - off < BENCH_LOAD) ? len - off : BENCH_LOAD;
+              SET_ML_SLICE (&src, buf + off, n);
+              off += n;
+            }
+          else
+            END_ML_SLICE (&src);
+          break;
+
+        case NEXT_END:
+          if (tk->len == 0)
+            break;
+          /* the last token */
+          __attribute__((fallthrough));
+        case NEXT_MATCH:
+        case NEXT_CHUNK:
+        case NEXT_ZTERM:
+          h = bench_hash (h, &ret, sizeof (ret));
+          h = bench_hash (h, &tk->type, sizeof (tk->type));
+          if (tk->type == TK_KEYWORD || tk->type == TK_PUNCS)
+            h = bench_hash (h, &tk->id, sizeof (tk->id));
+          h = bench_hash (h, tk->ptr, tk->len);
+          b->tokens++;
+          break;
+
+        default: break;
+        }
+    }
+  b->sec = now () - b->sec;
+  b->hash = h;
+}
+
+int
+main (int argc, char **argv)
+{
+  int ret = 0;
+  FILE *golden = NULL;
+  bool record = false;
+  char *buf, line[128], expected[128];
+
+  if (argc > 1)
+    {
+      /* the first run records the golden file */
+      if ((golden = fopen (argv[1], "r")) == NULL)
+        {
+          if ((golden = fopen (argv[1], "w")) == NULL)
+            {
+              perror ("fopen");
+              return 1;
+            }
+          record = true;
+        }
+    }
+  if ((buf = malloc (BENCH_SIZE)) == NULL)
+    {
+      perror ("malloc");
+      return 1;
+    }
+
+  snprintf (line, sizeof (line), "size %d, load %d\n",
+            BENCH_SIZE, BENCH_LOAD);
+  if (record)
+    fputs (line, golden);
+  else if (golden && (!fgets (expected, sizeof (expected), golden)
+                      || strcmp (line, expected) != 0))
+    {
+      fprintf (stderr, "%s: not a golden file of this configuration\n",
+               argv[1]);
+      ret = 1;
+      goto eo_main;
+    }
+
+  for (size_t i = 0; i < sizeof (Corpora) / sizeof (*Corpora); ++i)
+    {
+      rnd_state = 0x9e3779b97f4a7c15ULL;
+      size_t len = Corpora[i].gen (buf, BENCH_SIZE);
+
+      for (size_t j = 0; j < sizeof (Configs) / sizeof (*Configs); ++j)
+        {
+          Milexer *cml = Configs[j].ml;
+          if (Configs[j].compiled && !cml->__compiled)
+            ml_compile (cml);
+          else if (!Configs[j].compiled)
+            ml_uncompile (cml);
+
+          struct bench_t whole[sizeof (Token_Caps) / sizeof (*Token_Caps)];
+          for (int lazy = 0; lazy <= 1; ++lazy)
+            for (size_t k = 0; k < sizeof (Token_Caps) / sizeof (*Token_Caps); ++k)
+              {
+                struct bench_t b;
+                Milexer_Token tk = TOKEN_ALLOC (Token_Caps[k]);
+                bench_run (cml, Configs[j].flags, &tk, buf, len, lazy, &b);
+                TOKEN_FREE (&tk);
+                if (!lazy)
+                  whole[k] = b;
+
+                snprintf (line, sizeof (line), "%s %s %s %zu: %zu %08x\n",
+                          Corpora[i].name, Configs[j].name,
+                          lazy ? "lazy" : "whole", Token_Caps[k],
+                          b.tokens, b.hash);
+                const char *status = "";
+                if (record)
+                  fputs (line, golden);
+                else if (golden)
+                  {
+                    if (fgets (expected, sizeof (expected), golden)
+                        && strcmp (line, expected) == 0)
+                      status = "pass";
+                    else
+                      status = "fail", ret = 1;
+                  }
+                /* zero-copy tokens are fragmented differently by loads */
+                if (lazy && !HAS_FLAG (Configs[j].flags, PFLAG_ZEROCOPY)
+                    && (b.tokens != whole[k].tokens
+                        || b.hash != whole[k].hash))
+                  status = "fail (lazy != whole)", ret = 1;
+                printf ("%-6s  %-7s  %-5s  %4zu  %8.2f MB/s  %6.2f M tokens/s  %s\n",
+                        Corpora[i].name, Configs[j].name,
+                        lazy ? "lazy" : "whole", Token_Caps[k],
+                        len / b.sec / 1e6, b.tokens / b.sec / 1e6, status);
+              }
+        }
+    }
+  ml_uncompile (&ml);
+  ml_uncompile (&ml_words);
+
+ eo_main:
+  free (buf);
+  if (golden)
+    fclose (golden);
+  return ret;
+}
+#endif /* ML_BENCH */
@@ -18,10 +18,16 @@
         To compile with buffered_io.h
      -D_BMAX="(1 * 1024)":
         To max buffer length of buffered IO
+     -D_USE_THREADS -pthread:
+        To enable parallel lexing of input files (-j)
  **/
 #include <stdio.h>
+#include <errno.h>
+#include <stdint.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #ifdef _USE_BIO
 # ifndef _BMAX
@@ -33,6 +39,7 @@
 
 #define Version "2"
 #define PROGRAM_NAME "key_extractor"
+#define UNUSED(x) (void)(x)
 #define CLI_IMPLEMENTATION
 #define CLI_NO_GETOPT /* we handle options ourselves */
 #include "clistd.h"
@@ -64,6 +71,15 @@ static struct option const long_options[] =
   {"str",       no_argument,       NULL, 's'},
   {"full-str",  no_argument,       NULL, 'S'},
   {"no-str",    no_argument,       NULL, 'z'},
+  /* parallel lexing */
+  {"jobs",      required_argument, NULL, 'j'},
+  /* input buffer length */
+  {"buffer",    required_argument, NULL, 'b'},
+  /* deduplication and counting */
+  {"unique",    no_argument,       NULL, 'u'},
+  {"count",     no_argument,       NULL, 'c'},
+  {"top",       required_argument, NULL, 't'},
+  {"mem",       required_argument, NULL, 'm'},
   {NULL,        0,                 NULL,  0 },
 };
 
@@ -71,6 +87,13 @@ static struct option const long_options[] =
 #include "dyna.h"
 
 #define TOKEN_MAX_BUF_LEN (512) // 0.5Kb
+/* the default input buffer length, when it cannot be mapped */
+#define INPUT_BUF_LEN (256 * 1024) // 256Kb
+/* the default memory limit of deduplication, see -m */
+#define DEDUP_MEM (256 * 1024 * 1024) // 256Mb
+#ifdef _USE_THREADS
+# define ML_PARALLEL
+#endif
 #define ML_IMPLEMENTATION
 #include "mini-lexer.c"
 
@@ -115,6 +138,14 @@ static const char *Delimiters[] = {
 static const char **Extra_Delims = NULL;
 
 int kflags = 0;
+/* number of threads, see -j */
+int jobs = 1;
+/* length of the input buffer, see -b */
+size_t buf_len = INPUT_BUF_LEN;
+/* only the top_k most frequent tokens, see -t */
+size_t top_k = 0;
+/* memory limit of the deduplication table, see -m */
+size_t mem_limit = DEDUP_MEM;
 
 enum key_flags_t
   {
@@ -128,6 +159,9 @@ enum key_flags_t
     /* user has provided additional delimiters */
     EXT_DELIMS = 0x10,
     OVERWRITE_DELIMS = 0x20,
+    /* print each token once, and their counts */
+    UNIQUE = 0x40,
+    COUNT = 0x80,
   };
 
 static Milexer ML = {
@@ -176,6 +210,14 @@ OPTIONS:\n\
      -d, --add-delim   to add extra delimiter(s)\n\
                        Example:  `-d_ -d \"ad\"` means `_` and `a`,...,`d`\n\
      -D                to overwrite the default delimiters\n\
+     -j, --jobs        number of threads, only for input files\n\
+     -b, --buffer      input buffer length of pipes (default: 256K)\n\
+                       Example:  `-b 4096`, `-b 64K` or `-b 1M`\n\
+     -u, --unique      print each token once, in sorted order\n\
+     -c, --count       print tokens with their counts, like `uniq -c`\n\
+     -t, --top         only the top N most frequent tokens, implies -c\n\
+     -m, --mem         memory limit of -u and -c (default: 256M),\n\
+                       beyond that, it uses temporary files\n\
 ");
 }
 
@@ -196,6 +238,21 @@ safe_open (const char *restrict pathname, const char *restrict mode)
   return fileno (f);
 }
 
+/* parses sizes like 4096, 64K, 1M or 2G, @return 0 on failure */
+static size_t
+parse_size (const char *str)
+{
+  char *end;
+  size_t n = strtoul (str, &end, 10);
+  switch (*end)
+    {
+    case 'k': case 'K': n <<= 10; end++; break;
+    case 'm': case 'M': n <<= 20; end++; break;
+    case 'g': case 'G': n <<= 30; end++; break;
+    }
+  return (*end == '\0') ? n : 0;
+}
+
 /**
  *  @return:  0 -> success
  *     negative -> exit with 0 code
@@ -205,7 +262,7 @@ int
 parse_args (int argc, char **argv)
 {
   int c;
-  const char *params = "+i:o:a:d:DvhnsSz";
+  const char *params = "+i:o:a:d:j:b:t:m:DvhnsSzuc";
   while (1)
     {
       c = getopt_long (argc, argv, params, long_options, NULL);
@@ -246,6 +303,58 @@ parse_args (int argc, char **argv)
           kflags |= OVERWRITE_DELIMS;
           break;
 
+        case 'j':
+          if ((jobs = atoi (optarg)) <= 0)
+            {
+              warnln ("invalid number of jobs -- (%s)", optarg);
+              return 1;
+            }
+#ifndef _USE_THREADS
+          if (jobs > 1)
+            warnln ("not compiled with _USE_THREADS, -j was ignored");
+#endif
+          break;
+
+        case 'b':
+          if ((buf_len = parse_size (optarg)) == 0)
+            {
+              warnln ("invalid buffer length -- (%s)", optarg);
+              return 1;
+            }
+          break;
+
+        case 'u':
+          kflags |= UNIQUE;
+          break;
+
+        case 'c':
+          kflags |= COUNT;
+          break;
+
+        case 't':
+          {
+            /* a count, not a size, so no K/M/G suffixes */
+            char *end;
+            errno = 0;
+            long long t = strtoll (optarg, &end, 10);
+            if (errno || end == optarg || *end || t <= 0)
+              {
+                warnln ("invalid number of tokens -- (%s)", optarg);
+                return 1;
+              }
+            top_k = t;
+          }
+          kflags |= COUNT;
+          break;
+
+        case 'm':
+          if ((mem_limit = parse_size (optarg)) == 0)
+            {
+              warnln ("invalid memory limit -- (%s)", optarg);
+              return 1;
+            }
+          break;
+
         case 'i':
           if (infd != STDIN_FILENO)
             close (infd);
@@ -274,12 +383,528 @@ parse_args (int argc, char **argv)
   return 0;
 }
 
+/**
+ *  Deduplication (-u, -c and -t)
+ *  Output lines are counted in an open addressing hash table,
+ *  keys are stored back to back in @dd.keys
+ *  When the table exceeds @mem_limit, it is sorted and spilled
+ *  to a temporary file (a run), and at the end, the runs are
+ *  merged, so the output is sorted like `sort | uniq -c`
+ */
+#define DEDUP_INIT_CAP (1 << 16)
+/* maximum number of runs, before merging them into one */
+#define DEDUP_MAX_RUNS 64
+
+struct entry_t
+{
+  size_t off;     /* offset of the key in dd.keys */
+  size_t count;   /* zero for empty slots */
+  uint32_t len;
+  uint32_t hash;
+};
+
+/* a spilled run, and its current record */
+struct run_t
+{
+  FILE *f;
+  char *key;
+  size_t cap;
+  uint32_t len;
+  size_t count;
+};
+
+/* a top-k heap entry */
+struct top_t
+{
+  char *key;
+  size_t count;
+};
+
+static struct
+{
+  struct entry_t *tab;
+  size_t cap, n;
+  char *keys;           /* dynamic array of keys */
+  char *line;           /* dynamic array of the current line */
+  struct run_t *runs;   /* dynamic array of spilled runs */
+  struct top_t *top;    /* the top-k min-heap */
+  size_t top_n, top_cap;
+} dd;
+
+static inline uint32_t
+dd_hash (const char *key, size_t len)
+{
+  uint32_t h = 2166136261U;
+  for (size_t i=0; i < len; ++i)
+    h = (h ^ (unsigned char) key[i]) * 16777619U;
+  return h;
+}
+
+/* compares like `LC_ALL=C sort` */
+static inline int
+dd_cmp (const char *k1, size_t l1, const char *k2, size_t l2)
+{
+  int c = memcmp (k1, k2, l1 < l2 ? l1 : l2);
+  if (c != 0)
+    return c;
+  return (l1 > l2) - (l1 < l2);
+}
+
+static int
+dd_entry_cmp (const void *a, const void *b)
+{
+  const struct entry_t *e1 = a, *e2 = b;
+  return dd_cmp (dd.keys + e1->off, e1->len, dd.keys + e2->off, e2->len);
+}
+
+static inline size_t
+dd_mem (void)
+{
+  return da_sizeof (dd.keys) + dd.cap * sizeof (struct entry_t);
+}
+
+static void
+dd_init (void)
+{
+  /* the table itself must not take more than half of the memory */
+  dd.cap = DEDUP_INIT_CAP;
+  while (dd.cap > 16 && dd.cap * sizeof (struct entry_t) > mem_limit / 2)
+    dd.cap >>= 1;
+  dd.tab = calloc (dd.cap, sizeof (struct entry_t));
+  dd.keys = da_new (char);
+  dd.line = da_new (char);
+  dd.runs = da_new (struct run_t);
+  if (!dd.tab)
+    {
+      warnln ("could not allocate the deduplication table");
+      exit (1);
+    }
+}
+
+/* finds the slot of @key, which is either empty or holds @key */
+static inline struct entry_t *
+dd_lookup (struct entry_t *tab, size_t cap,
+           const char *key, size_t len, uint32_t hash)
+{
+  size_t mask = cap - 1;
+  for (size_t i = hash & mask;; i = (i + 1) & mask)
+    {
+      struct entry_t *e = tab + i;
+      if (e->count == 0)
+        return e;
+      if (e->hash == hash && e->len == len
+          && memcmp (dd.keys + e->off, key, len) == 0)
+        return e;
+    }
+}
+
+static void
+dd_grow (void)
+{
+  size_t cap = dd.cap << 1;
+  struct entry_t *tab = calloc (cap, sizeof (struct entry_t));
+  if (!tab)
+    {
+      warnln ("could not grow the deduplication table");
+      exit (1);
+    }
+  for (size_t i=0; i < dd.cap; ++i)
+    {
+      struct entry_t *e = dd.tab + i;
+      if (e->count == 0)
+        continue;
+      /* keys are distinct, so any free slot is the right one */
+      size_t mask = cap - 1, j = e->hash & mask;
+      while (tab[j].count != 0)
+        j = (j + 1) & mask;
+      tab[j] = *e;
+    }
+  free (dd.tab);
+  dd.tab = tab;
+  dd.cap = cap;
+}
+
+/**
+ *  Moves the occupied slots to the beginning
+ *  of the table and sorts them by their keys
+ */
+static void
+dd_sort (void)
+{
+  size_t n = 0;
+  for (size_t i=0; i < dd.cap; ++i)
+    if (dd.tab[i].count != 0)
+      dd.tab[n++] = dd.tab[i];
+  qsort (dd.tab, n, sizeof (struct entry_t), dd_entry_cmp);
+}
+
+static inline void
+dd_write (FILE *f, const char *key, uint32_t len, size_t count)
+{
+  fwrite (&len, sizeof (len), 1, f);
+  fwrite (&count, sizeof (count), 1, f);
+  fwrite (key, 1, len, f);
+}
+
+/* reads the next record of @r, @return 0 at the end */
+static int
+dd_read (struct run_t *r)
+{
+  if (fread (&r->len, sizeof (r->len), 1, r->f) != 1
+      || fread (&r->count, sizeof (r->count), 1, r->f) != 1)
+    return 0;
+  if (r->len + 1 > r->cap)
+    {
+      char *key = realloc (r->key, r->len + 1);
+      if (!key)
+        {
+          warnln ("could not allocate %u bytes", r->len + 1);
+          exit (1);
+        }
+      r->key = key;
+      r->cap = r->len + 1;
+    }
+  if (fread (r->key, 1, r->len, r->f) != r->len)
+    return 0;
+  r->key[r->len] = '\0';
+  return 1;
+}
+
+static void
+dd_emit (const char *key, size_t count)
+{
+  if (top_k)
+    {
+      /**
+       *  The top of the heap is the least frequent token,
+       *  and for equal counts, the greatest one
+       */
+#define TOP_LESS(a, b) ((a).count < (b).count \
+                        || ((a).count == (b).count \
+                            && strcmp ((a).key, (b).key) > 0))
+      struct top_t t = {.key = (char *) key, .count = count};
+      size_t i;
+      if (dd.top_n < top_k)
+        {
+          if (dd.top_n == dd.top_cap)
+            {
+              size_t cap = dd.top_cap ? dd.top_cap << 1 : 16;
+              struct top_t *top = realloc (dd.top, cap * sizeof (struct top_t));
+              if (!top)
+                {
+                  warnln ("could not grow the top tokens");
+                  exit (1);
+                }
+              dd.top = top;
+              dd.top_cap = cap;
+            }
+          /* sift up */
+          for (i = dd.top_n++; i > 0; i = (i - 1) / 2)
+            {
+              if (!TOP_LESS (t, dd.top[(i - 1) / 2]))
+                break;
+              dd.top[i] = dd.top[(i - 1) / 2];
+            }
+        }
+      else if (TOP_LESS (dd.top[0], t))
+        {
+          free (dd.top[0].key);
+          /* sift down */
+          for (i = 0; 2*i + 1 < dd.top_n;)
+            {
+              size_t c = 2*i + 1;
+              if (c + 1 < dd.top_n && TOP_LESS (dd.top[c + 1], dd.top[c]))
+                c++;
+              if (!TOP_LESS (dd.top[c], t))
+                break;
+              dd.top[i] = dd.top[c];
+              i = c;
+            }
+        }
+      else
+        return;
+      if (!(t.key = strdup (key)))
+        {
+          warnln ("could not allocate the top tokens");
+          exit (1);
+        }
+      dd.top[i] = t;
+      return;
+    }
+
+  if (kflags & COUNT)
+    {
+      char num[32];
+      snprintf (num, sizeof (num), "%7zu ", count);
+      Print (num);
+    }
+  Print (key);
+  Putln ();
+}
+
+/**
+ *  Merges the spilled runs, into @out when it's not NULL
+ *  or otherwise to the output
+ */
+static void
+dd_merge (FILE *out)
+{
+  size_t hn = 0, nruns = da_sizeof (dd.runs);
+  size_t *heap = malloc (nruns * sizeof (size_t));
+  struct run_t *R = dd.runs;
+  if (!heap)
+    {
+      warnln ("could not allocate the merge heap");
+      exit (1);
+    }
+#define RUN_LESS(a, b) (dd_cmp (R[a].key, R[a].len, R[b].key, R[b].len) < 0)
+
+  for (size_t i=0; i < nruns; ++i)
+    {
+      rewind (R[i].f);
+      if (!dd_read (R + i))
+        continue;
+      size_t j = hn++;
+      for (; j > 0 && RUN_LESS (i, heap[(j - 1) / 2]); j = (j - 1) / 2)
+        heap[j] = heap[(j - 1) / 2];
+      heap[j] = i;
+    }
+
+  char *cur = da_new (char);
+  size_t cur_count = 0;
+  while (hn > 0)
+    {
+      struct run_t *r = R + heap[0];
+      if (cur_count != 0
+          && dd_cmp (cur, da_sizeof (cur) - 1, r->key, r->len) == 0)
+        {
+          cur_count += r->count;
+        }
+      else
+        {
+          if (cur_count != 0)
+            {
+              if (out)
+                dd_write (out, cur, da_sizeof (cur) - 1, cur_count);
+              else
+                dd_emit (cur, cur_count);
+            }
+          da_drop (cur);
+          da_extend (cur, r->key, r->len + 1);
+          cur_count = r->count;
+        }
+
+      /* advance the run on the top of the heap */
+      size_t top = heap[0];
+      if (!dd_read (r))
+        top = heap[--hn];
+      size_t i = 0;
+      for (;;)
+        {
+          size_t c = 2*i + 1;
+          if (c >= hn)
+            break;
+          if (c + 1 < hn && RUN_LESS (heap[c + 1], heap[c]))
+            c++;
+          if (!RUN_LESS (heap[c], top))
+            break;
+          heap[i] = heap[c];
+          i = c;
+        }
+      if (hn > 0)
+        heap[i] = top;
+    }
+  if (cur_count != 0)
+    {
+      if (out)
+        dd_write (out, cur, da_sizeof (cur) - 1, cur_count);
+      else
+        dd_emit (cur, cur_count);
+    }
+
+  for (size_t i=0; i < nruns; ++i)
+    {
+      fclose (R[i].f);
+      free (R[i].key);
+    }
+  da_drop (dd.runs);
+  da_free (cur);
+  free (heap);
+}
+
+/* writes the table to a new run, and resets it */
+static void
+dd_spill (void)
+{
+  struct run_t r = {0};
+  if ((r.f = tmpfile ()) == NULL)
+    {
+      warnln ("could not create a temporary file -- %s", strerror (errno));
+      exit (1);
+    }
+  dd_sort ();
+  for (size_t i=0; i < dd.n; ++i)
+    dd_write (r.f, dd.keys + dd.tab[i].off, dd.tab[i].len, dd.tab[i].count);
+  if (ferror (r.f))
+    {
+      warnln ("could not write the temporary file");
+      exit (1);
+    }
+  memset (dd.tab, 0, dd.cap * sizeof (struct entry_t));
+  dd.n = 0;
+  da_drop (dd.keys);
+  da_appd (dd.runs, r);
+
+  /* too many runs, merge them into one */
+  if (da_sizeof (dd.runs) >= DEDUP_MAX_RUNS)
+    {
+      if ((r.f = tmpfile ()) == NULL)
+        {
+          warnln ("could not create a temporary file -- %s",
+                  strerror (errno));
+          exit (1);
+        }
+      dd_merge (r.f);
+      da_appd (dd.runs, r);
+    }
+}
+
+static void
+dd_insert (const char *key, size_t len)
+{
+  uint32_t hash = dd_hash (key, len);
+  struct entry_t *e = dd_lookup (dd.tab, dd.cap, key, len, hash);
+  if (e->count != 0)
+    {
+      e->count++;
+      return;
+    }
+  *e = (struct entry_t){
+    .off = da_sizeof (dd.keys), .count = 1, .len = len, .hash = hash
+  };
+  /* keys are nul-terminated, to be printed */
+  da_extend (dd.keys, key, len);
+  da_appd (dd.keys, '\0');
+  dd.n++;
+
+  if (2 * dd.n > dd.cap)
+    {
+      if (da_sizeof (dd.keys) + 2 * dd.cap * sizeof (struct entry_t)
+          > mem_limit)
+        dd_spill ();
+      else
+        dd_grow ();
+    }
+  else if (dd_mem () > mem_limit)
+    dd_spill ();
+}
+
+/* prints the result of deduplication, and frees everything */
+static void
+dd_finish (void)
+{
+  /* the last token, without any newline */
+  if (da_sizeof (dd.line) > 0)
+    dd_insert (dd.line, da_sizeof (dd.line));
+
+  if (da_sizeof (dd.runs) == 0)
+    {
+      dd_sort ();
+      for (size_t i=0; i < dd.n; ++i)
+        dd_emit (dd.keys + dd.tab[i].off, dd.tab[i].count);
+    }
+  else
+    {
+      if (dd.n > 0)
+        dd_spill ();
+      dd_merge (NULL);
+    }
+
+  if (top_k)
+    {
+      /* pop the heap, from the least frequent token */
+      struct top_t *T = dd.top;
+      size_t n = dd.top_n;
+      while (dd.top_n > 0)
+        {
+          struct top_t t = T[--dd.top_n];
+          T[dd.top_n] = T[0];
+          size_t i = 0;
+          for (;;)
+            {
+              size_t c = 2*i + 1;
+              if (c >= dd.top_n)
+                break;
+              if (c + 1 < dd.top_n && TOP_LESS (T[c + 1], T[c]))
+                c++;
+              if (!TOP_LESS (T[c], t))
+                break;
+              T[i] = T[c];
+              i = c;
+            }
+          if (dd.top_n > 0)
+            T[i] = t;
+        }
+      /* now @T is sorted from the most frequent token */
+      kflags &= ~UNIQUE;
+      top_k = 0;
+      for (size_t i=0; i < n; ++i)
+        {
+          dd_emit (T[i].key, T[i].count);
+          free (T[i].key);
+        }
+      free (T);
+    }
+
+  free (dd.tab);
+  da_free (dd.keys);
+  da_free (dd.line);
+  da_free (dd.runs);
+}
+
+/**
+ *  Prints a piece of the current output line
+ *  Tokens might contain newlines, in the deduplication mode,
+ *  they are counted as separate lines, like `sort | uniq -c`
+ */
+static inline void
+out_piece (const char *cstr)
+{
+  if (kflags & (UNIQUE | COUNT))
+    {
+      const char *nl;
+      while ((nl = strchr (cstr, '\n')))
+        {
+          da_extend (dd.line, cstr, nl - cstr);
+          dd_insert (dd.line, da_sizeof (dd.line));
+          da_drop (dd.line);
+          cstr = nl + 1;
+        }
+      da_extend (dd.line, cstr, strlen (cstr));
+    }
+  else
+    Print (cstr);
+}
+
+/* ends the current output line */
+static inline void
+out_line (void)
+{
+  if (kflags & (UNIQUE | COUNT))
+    {
+      dd_insert (dd.line, da_sizeof (dd.line));
+      da_drop (dd.line);
+    }
+  else
+    Putln ();
+}
+
 static inline int
 token_out (const char *cstr)
 {
   if (kflags & ALLOW_NUMBERS)
     {
-      Print (cstr);
+      out_piece (cstr);
       return 1;
     }
   else
@@ -290,22 +915,96 @@ token_out (const char *cstr)
         {
           return 0;
         }
+      errno = 0;
       strtol (cstr, &end, 10);
-      if (*(end + 1) == '\0' && errno == 0)
+      if (*end == '\0' && errno == 0)
         {
           return 0;
         }
-      Print (cstr);
+      out_piece (cstr);
       return 1;
     }
   return -1; /* unreachable */
 }
 
+/* ml_feed and ml_parallel callback */
+static int
+results_out (const Milexer_Result *res, size_t n, void *arg)
+{
+  UNUSED (arg);
+  char cstr[TOKEN_MAX_BUF_LEN + 1];
+  /* the previous result, the end of chunked tokens might be empty */
+  static int printed, chunked;
+  for (size_t i=0; i < n; ++i)
+    {
+      if (!(kflags & ALLOW_STRINGS) && res[i].type != TK_KEYWORD)
+        continue;
+      /**
+       *  zero-copy tokens are not limited to TOKEN_MAX_BUF_LEN,
+       *  they are printed in chunks, like NEXT_CHUNK tokens
+       */
+      const char *ptr = res[i].ptr;
+      size_t rest = res[i].len;
+      if (!chunked || rest > 0)
+        do
+          {
+            size_t len = rest < TOKEN_MAX_BUF_LEN ? rest : TOKEN_MAX_BUF_LEN;
+            memcpy (cstr, ptr, len);
+            cstr[len] = '\0';
+            printed = token_out (cstr);
+            ptr += len;
+            rest -= len;
+          }
+        while (rest > 0);
+      chunked = res[i].ret == NEXT_CHUNK;
+      if (printed && !chunked)
+        out_line ();
+    }
+  return 0;
+}
+
+/**
+ *  Maps the input, when it is a regular file
+ *  @return the mapping of length @len, or NULL
+ */
+static char *
+map_input (size_t *len)
+{
+  struct stat st;
+  if (fstat (infd, &st) != 0 || !S_ISREG (st.st_mode) || st.st_size == 0)
+    return NULL;
+  char *map = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, infd, 0);
+  if (map == MAP_FAILED)
+    return NULL;
+  madvise (map, st.st_size, MADV_SEQUENTIAL);
+  *len = st.st_size;
+  return map;
+}
+
+#ifdef _USE_THREADS
+/* parallel lexing of the mapped input, using @jobs threads */
+static void
+parallel_lex (const char *map, size_t len, int parse_flg)
+{
+  Milexer_Parallel opt = {
+    .flags    = parse_flg,
+    .tk_cap   = TOKEN_MAX_BUF_LEN,
+    .nthreads = jobs,
+    .ordered  = true,
+    .emit     = results_out,
+  };
+  if (ml_parallel (&ML, map, len, &opt) != 0)
+    warnln ("parallel lexing failed");
+}
+#endif /* _USE_THREADS */
+
 int
 main (int argc, char **argv)
 {
   set_program_name (*argv);
-  Extra_Delims = da_new (const char *);
+  /* enough for the defaults, it allocates only for many -d */
+  da_inline (const char *, delims, 16);
+  Extra_Delims = delims;
   int ret = parse_args (argc, argv);
   if (ret > 0)
     return ret;
@@ -326,8 +1025,7 @@ main (int argc, char **argv)
     }
   else
     {
-      for (size_t i=0; i < GEN_LENOF (Delimiters); ++i)
-        da_appd (Extra_Delims, Delimiters[i]);
+      da_extend (Extra_Delims, Delimiters, GEN_LENOF (Delimiters));
       ML.delim_ranges.exp = Extra_Delims;
     }
 
@@ -351,6 +1049,7 @@ main (int argc, char **argv)
 
   /* Update the length of delimiter ranges */
   ML.delim_ranges.len = da_sizeof (Extra_Delims);
+  ml_compile (&ML);
   
   /* Parsing flags */
   int parse_flg;
@@ -364,10 +1063,11 @@ main (int argc, char **argv)
       parse_flg = PFLAG_INEXP;
     }
 
-  int buf_len = TOKEN_MAX_BUF_LEN;
-  char *buf = malloc (buf_len);
-  Milexer_Token tk = TOKEN_ALLOC (TOKEN_MAX_BUF_LEN);
-  Milexer_Slice src = {.lazy = true};
+  Milexer_Feed feed = {
+    .flags  = parse_flg,
+    .tk_cap = TOKEN_MAX_BUF_LEN,
+    .emit   = results_out,
+  };
 
   /**
    *  Initializing buffered IO
@@ -380,44 +1080,69 @@ main (int argc, char **argv)
   bio = bio_new (bio_cap, malloc (bio_cap), ofd);
 #endif
 
-  if (infd == STDIN_FILENO && isatty (infd))
+  if (kflags & (UNIQUE | COUNT))
+    dd_init ();
+
+  /**
+   *  regular files are parsed at once, the mapping is stable
+   *  so tokens can point into it (zero-copy)
+   */
+  size_t map_len;
+  char *map = map_input (&map_len);
+  if (map)
     {
-      puts ("reading from stdin until EOF");
+      parse_flg |= PFLAG_ZEROCOPY;
+      feed.flags = parse_flg;
+#ifdef _USE_THREADS
+      if (jobs > 1)
+        parallel_lex (map, map_len, parse_flg);
+      else
+        ml_feed (&ML, &feed, map, map_len);
+#else
+      ml_feed (&ML, &feed, map, map_len);
+#endif
     }
-
-  int len;
-  for (int ret = 0; !NEXT_SHOULD_END (ret); )
+  else
     {
-      ret = ml_next (&ML, &src, &tk, parse_flg);
-      switch (ret)
+      if (infd == STDIN_FILENO && isatty (infd))
         {
-        case NEXT_NEED_LOAD:
-          if ((len = read (infd, buf, buf_len)) > 0)
-            SET_ML_SLICE (&src, buf, len);
-          else
-            END_ML_SLICE (&src);
-          break; 
- 
-        case NEXT_CHUNK:
-          if ((kflags & ALLOW_STRINGS) || tk.type == TK_KEYWORD)
-            token_out (tk.cstr);
-          break;
+          puts ("reading from stdin until EOF");
+        }
+
+      /* pipes and terminals, using a large page-aligned buffer */
+      size_t page = sysconf (_SC_PAGESIZE);
+      buf_len = (buf_len + page - 1) / page * page;
+      char *buf = aligned_alloc (page, buf_len);
+      if (!buf)
+        {
+          warnln ("could not allocate %zu bytes", buf_len);
+          buf_len = 0;
+        }
 
-        case NEXT_MATCH:
-        case NEXT_ZTERM:
-          if ((kflags & ALLOW_STRINGS) || tk.type == TK_KEYWORD)
+      ssize_t len = 0;
+      while (buf_len && (len = read (infd, buf, buf_len)) != 0)
+        {
+          if (len < 0)
             {
-              if (token_out (tk.cstr))
-                Putln ();
+              if (errno == EINTR)
+                continue;
+              warnln ("could not read the input -- %s", strerror (errno));
+              exit (1);
             }
-          break;
-
-        default: break;
+          if (ml_feed (&ML, &feed, buf, len) != 0)
+            break;
         }
-     }
-  
-  TOKEN_FREE (&tk);
-  free (buf);
+      free (buf);
+    }
+  if (ml_feed (&ML, &feed, NULL, 0) != 0)
+    warnln ("parsing failed");
+
+  if (kflags & (UNIQUE | COUNT))
+    dd_finish ();
+
+  if (map)
+    munmap (map, map_len);
+  ml_uncompile (&ML);
 
 #ifdef _USE_BIO
   bio_flush (&bio);